@@ -29,53 +29,54 @@
 *********************************************************************************/
 #include "SystemConfiguration.h"
 #include "AddressMapping.h"
+#include <sstream>
+
+//every field is one contiguous bit range, which shift and mask extract at
+//  least as fast as PEXT, and AMD before Zen 3 runs PEXT in microcode; it is
+//  only used when built with make PEXT=1 (-DADDRESS_MAPPING_PEXT) and the
+//  host has BMI2
+#if defined(ADDRESS_MAPPING_PEXT)
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#else
+#undef ADDRESS_MAPPING_PEXT
+#endif
+#endif
 
 namespace DRAMSim
 {
 
-void addressMapping(uint64_t physicalAddress, unsigned &newTransactionChan, unsigned &newTransactionRank, unsigned &newTransactionBank, unsigned &newTransactionRow, unsigned &newTransactionColumn, std::vector<IniReader*>allIniReaders)
+//the DRAM channels come first and the NVM ones after them, each type covers
+//  its own range of the physical address space
+AddressMapping::AddressMapping(const vector<IniReader*> &allIniReaders)
 {
-	//xf
-	unsigned SystemType;
-	uint64_t physicalAddr=0;
-	if (physicalAddress < allIniReaders[TYPE_DRAM]->TOTAL_STORAGE<<20)
-	{
-		SystemType = TYPE_DRAM;
-		physicalAddr = physicalAddress;	
-	}
-	else if (physicalAddress >= (allIniReaders[TYPE_DRAM]->TOTAL_STORAGE<<20) && physicalAddress < ((allIniReaders[TYPE_DRAM]->TOTAL_STORAGE<<20) + (allIniReaders[TYPE_NVM]->TOTAL_STORAGE<<20)))
-	{
-		SystemType = TYPE_NVM;
-		physicalAddr = physicalAddress - allIniReaders[TYPE_DRAM]->TOTAL_STORAGE;
-	}
-	else
-	{
-		ERROR("== Error - Unknown Physical Address, physical address is larger than total storage.");
-		exit(-1);
-	}
-	newTransactionChan = SystemType;
+	IniReader *dramTier = allIniReaders[0];
+	uint64_t dramStorage = ((uint64_t)dramTier->TOTAL_STORAGE * dramTier->NUM_CHANS) << 20;
+	dram = buildLayout(dramTier, 0, 0);
+	nvm = buildLayout(allIniReaders[dramTier->NUM_CHANS], dramTier->NUM_CHANS, dramStorage);
+#ifdef ADDRESS_MAPPING_PEXT
+	usePext = __builtin_cpu_supports("bmi2");
+#else
+	usePext = false;
+#endif
+}
 
-	uint64_t tempA, tempB;
-	unsigned transactionSize = (allIniReaders[SystemType]->JEDEC_DATA_BUS_BITS/8)*allIniReaders[SystemType]->BL; 
-	uint64_t transactionMask =  transactionSize - 1; //ex: (64 bit bus width) x (8 Burst Length) - 1 = 64 bytes - 1 = 63 = 0x3f mask
-	//unsigned channelBitWidth = dramsim_log2(NUM_CHANS);
-	unsigned	rankBitWidth = dramsim_log2(allIniReaders[SystemType]->NUM_RANKS);
-	unsigned	bankBitWidth = dramsim_log2(allIniReaders[SystemType]->NUM_BANKS);
-	unsigned	rowBitWidth = dramsim_log2(allIniReaders[SystemType]->NUM_ROWS);
-	unsigned	colBitWidth = dramsim_log2(allIniReaders[SystemType]->NUM_COLS);
+AddressMapping::TierLayout AddressMapping::buildLayout(IniReader *tier, unsigned firstChannel, uint64_t base)
+{
+	//all channels of a type share the same geometry
+	TierLayout layout;
+	layout.firstChannel = firstChannel;
+	layout.base = base;
+	layout.size = ((uint64_t)tier->TOTAL_STORAGE * tier->NUM_CHANS) << 20;
+
+	unsigned transactionSize = (tier->JEDEC_DATA_BUS_BITS/8)*tier->BL; 
+	unsigned channelBitWidth = dramsim_log2(tier->NUM_CHANS);
+	unsigned	rankBitWidth = dramsim_log2(tier->NUM_RANKS);
+	unsigned	bankBitWidth = dramsim_log2(tier->NUM_BANKS);
+	unsigned	rowBitWidth = dramsim_log2(tier->NUM_ROWS);
+	unsigned	colBitWidth = dramsim_log2(tier->NUM_COLS);
 	// this forces the alignment to the width of a single burst (64 bits = 8 bytes = 3 address bits for DDR parts)
-	unsigned	byteOffsetWidth = dramsim_log2((allIniReaders[SystemType]->JEDEC_DATA_BUS_BITS/8));
-	// Since we're assuming that a request is for BL*BUS_WIDTH, the bottom bits
-	// of this address *should* be all zeros if it's not, issue a warning
-
-	if ((physicalAddr & transactionMask) != 0)
-	{
-		//DEBUG("WARNING: address 0x"<<std::hex<<physicalAddr<<std::dec<<" is not aligned to the request size of "<<transactionSize); 
-	}
-
-	// each burst will contain JEDEC_DATA_BUS_BITS/8 bytes of data, so the bottom bits (3 bits for a single channel DDR system) are
-	// 	thrown away before mapping the other bits
-	physicalAddr >>= byteOffsetWidth;
+	unsigned	byteOffsetWidth = dramsim_log2((tier->JEDEC_DATA_BUS_BITS/8));
 
 	// The next thing we have to consider is that when a request is made for a
 	// we've taken into account the granulaity of a single burst by shifting 
@@ -95,239 +96,245 @@ void addressMapping(uint64_t physicalAddress, unsigned &newTransactionChan, unsi
 	// 
 	// For example: cowLowBits = log2(64bytes) - 3 bits = 3 bits 
 	unsigned colLowBitWidth = dramsim_log2(transactionSize) - byteOffsetWidth;
-
-	physicalAddr >>= colLowBitWidth;
 	unsigned colHighBitWidth = colBitWidth - colLowBitWidth; 
+
 	if (DEBUG_ADDR_MAP)
 	{
-		DEBUG("Bit widths: r:"<<rankBitWidth<<" b:"<<bankBitWidth
+		DEBUG("Bit widths: ch:"<<channelBitWidth<<" r:"<<rankBitWidth<<" b:"<<bankBitWidth
 				<<" row:"<<rowBitWidth<<" colLow:"<<colLowBitWidth
 				<< " colHigh:"<<colHighBitWidth<<" off:"<<byteOffsetWidth 
-				<< " Total:"<< (/*channelBitWidth + */rankBitWidth + bankBitWidth + rowBitWidth + colLowBitWidth + colHighBitWidth + byteOffsetWidth));
+				<< " Total:"<< (channelBitWidth + rankBitWidth + bankBitWidth + rowBitWidth + colLowBitWidth + colHighBitWidth + byteOffsetWidth));
 	}
 
-	//perform various address mapping schemes
-	if (allIniReaders[SystemType]->addressMappingScheme == Scheme1)
+	//the fixed schemes written the way a custom ADDRESS_MAPPING_SCHEME is:
+	//  the fields from the highest bits down. Whatever the scheme, the channel
+	//  comes lowest so that consecutive transactions are spread over all
+	//  channels of the type
+	string description;
+	switch (tier->addressMappingScheme)
 	{
-		//chan:rank:row:col:bank
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> bankBitWidth;
-		tempB = physicalAddr << bankBitWidth;
-		newTransactionBank = tempA ^ tempB;
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> colHighBitWidth;
-		tempB = physicalAddr << colHighBitWidth;
-		newTransactionColumn = tempA ^ tempB;
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> rowBitWidth;
-		tempB = physicalAddr << rowBitWidth;
-		newTransactionRow = tempA ^ tempB;
+	case Scheme1:
+		description = "ra:ro:co:ba:ch";
+		break;
+	case Scheme2:
+		description = "ro:co:ba:ra:ch";
+		break;
+	case Scheme3:
+		description = "ra:ba:co:ro:ch";
+		break;
+	case Scheme4:
+		description = "ra:ba:ro:co:ch";
+		break;
+	//scheme7 is scheme5 with the channel lowest, which every scheme now has
+	case Scheme5:
+	case Scheme7:
+		description = "ro:co:ra:ba:ch";
+		break;
+	case Scheme6:
+		description = "ro:ba:ra:co:ch";
+		break;
+	case SchemeCustom:
+		description = tier->ADDRESS_MAPPING_SCHEME;
+		break;
+	default:
+		ERROR("== Error - Unknown Address Mapping Scheme");
+		exit(-1);
+	}
 
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> rankBitWidth;
-		tempB = physicalAddr << rankBitWidth;
-		newTransactionRank = tempA ^ tempB;
-		/*
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> channelBitWidth;
-		tempB = physicalAddr << channelBitWidth;
-		newTransactionChan = tempA ^ tempB;
-		*/
+	//each of ra, ba, ro and co has to be there once; ch may be left out, the
+	//  channel then takes the lowest bits. A field can be followed by ^ and the
+	//  fields whose low bits are XORed into it, e.g. ro:ba^ro:ra:co:ch spreads
+	//  the rows of a bank over all banks
+	vector<string> terms;
+	istringstream descriptionStream(description);
+	string term;
+	while (getline(descriptionStream, term, ':'))
+	{
+		terms.push_back(term);
 	}
-	else if (allIniReaders[SystemType]->addressMappingScheme == Scheme2)
+	Field order[NUM_FIELDS];
+	size_t numOrdered = 0;
+	unsigned seen = 0;
+	layout.hasXor = false;
+	for (size_t i=0;i<NUM_FIELDS;i++)
 	{
-		//chan:row:col:bank:rank
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> rankBitWidth;
-		tempB = physicalAddr << rankBitWidth;
-		newTransactionRank = tempA ^ tempB;
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> bankBitWidth;
-		tempB = physicalAddr << bankBitWidth;
-		newTransactionBank = tempA ^ tempB;
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> colHighBitWidth;
-		tempB = physicalAddr << colHighBitWidth;
-		newTransactionColumn = tempA ^ tempB;
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> rowBitWidth;
-		tempB = physicalAddr << rowBitWidth;
-		newTransactionRow = tempA ^ tempB;
-		/*
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> channelBitWidth;
-		tempB = physicalAddr << channelBitWidth;
-		newTransactionChan = tempA ^ tempB;
-		*/
+		layout.xorFields[i] = 0;
 	}
-	else if (allIniReaders[SystemType]->addressMappingScheme == Scheme3)
+	if (terms.size() == NUM_FIELDS-1)
 	{
-		//chan:rank:bank:col:row
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> rowBitWidth;
-		tempB = physicalAddr << rowBitWidth;
-		newTransactionRow = tempA ^ tempB;
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> colHighBitWidth;
-		tempB = physicalAddr << colHighBitWidth;
-		newTransactionColumn = tempA ^ tempB;
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> bankBitWidth;
-		tempB = physicalAddr << bankBitWidth;
-		newTransactionBank = tempA ^ tempB;
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> rankBitWidth;
-		tempB = physicalAddr << rankBitWidth;
-		newTransactionRank = tempA ^ tempB;
-		/*
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> channelBitWidth;
-		tempB = physicalAddr << channelBitWidth;
-		newTransactionChan = tempA ^ tempB;
-		*/
+		order[numOrdered++] = ChannelField;
+		seen |= 1 << ChannelField;
 	}
-	else if (allIniReaders[SystemType]->addressMappingScheme == Scheme4)
+	else if (terms.size() != NUM_FIELDS)
 	{
-		//chan:rank:bank:row:col
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> colHighBitWidth;
-		tempB = physicalAddr << colHighBitWidth;
-		newTransactionColumn = tempA ^ tempB;
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> rowBitWidth;
-		tempB = physicalAddr << rowBitWidth;
-		newTransactionRow = tempA ^ tempB;
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> bankBitWidth;
-		tempB = physicalAddr << bankBitWidth;
-		newTransactionBank = tempA ^ tempB;
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> rankBitWidth;
-		tempB = physicalAddr << rankBitWidth;
-		newTransactionRank = tempA ^ tempB;
-		/*
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> channelBitWidth;
-		tempB = physicalAddr << channelBitWidth;
-		newTransactionChan = tempA ^ tempB;
-		*/
+		ERROR("== Error - Address mapping '"<<description<<"' needs the fields ch, ra, ba, ro and co separated by ':'");
+		exit(-1);
 	}
-	else if (allIniReaders[SystemType]->addressMappingScheme == Scheme5)
+	for (size_t i=terms.size();i>0;i--)
 	{
-		//chan:row:col:rank:bank
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> bankBitWidth;
-		tempB = physicalAddr << bankBitWidth;
-		newTransactionBank = tempA ^ tempB;
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> rankBitWidth;
-		tempB = physicalAddr << rankBitWidth;
-		newTransactionRank = tempA ^ tempB;
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> colHighBitWidth;
-		tempB = physicalAddr << colHighBitWidth;
-		newTransactionColumn = tempA ^ tempB;
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> rowBitWidth;
-		tempB = physicalAddr << rowBitWidth;
-		newTransactionRow = tempA ^ tempB;
-		/*
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> channelBitWidth;
-		tempB = physicalAddr << channelBitWidth;
-		newTransactionChan = tempA ^ tempB;
-		*/
-
+		istringstream termStream(terms[i-1]);
+		string name;
+		getline(termStream, name, '^');
+		Field field = parseField(name, description);
+		if (seen & (1 << field))
+		{
+			ERROR("== Error - Address mapping '"<<description<<"' has field '"<<name<<"' more than once");
+			exit(-1);
+		}
+		seen |= 1 << field;
+		order[numOrdered++] = field;
+		while (getline(termStream, name, '^'))
+		{
+			Field source = parseField(name, description);
+			if (source == field)
+			{
+				ERROR("== Error - Address mapping '"<<description<<"' XORs field '"<<name<<"' with itself");
+				exit(-1);
+			}
+			layout.xorFields[field] |= 1 << source;
+			layout.hasXor = true;
+		}
 	}
-	else if (allIniReaders[SystemType]->addressMappingScheme == Scheme6)
+	//XORing a field into another only stays reversible if the source isn't
+	//  changed itself
+	for (size_t i=0;i<NUM_FIELDS;i++)
 	{
-		//chan:row:bank:rank:col
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> colHighBitWidth;
-		tempB = physicalAddr << colHighBitWidth;
-		newTransactionColumn = tempA ^ tempB;
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> rankBitWidth;
-		tempB = physicalAddr << rankBitWidth;
-		newTransactionRank = tempA ^ tempB;
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> bankBitWidth;
-		tempB = physicalAddr << bankBitWidth;
-		newTransactionBank = tempA ^ tempB;
+		for (size_t j=0;j<NUM_FIELDS;j++)
+		{
+			if ((layout.xorFields[i] & (1 << j)) && layout.xorFields[j] != 0)
+			{
+				ERROR("== Error - Address mapping '"<<description<<"' XORs a field into another that has XOR terms of its own");
+				exit(-1);
+			}
+		}
+	}
 
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> rowBitWidth;
-		tempB = physicalAddr << rowBitWidth;
-		newTransactionRow = tempA ^ tempB;
-		/*
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> channelBitWidth;
-		tempB = physicalAddr << channelBitWidth;
-		newTransactionChan = tempA ^ tempB;
-		*/
+	unsigned width[NUM_FIELDS];
+	width[ChannelField] = channelBitWidth;
+	width[RankField] = rankBitWidth;
+	width[BankField] = bankBitWidth;
+	width[RowField] = rowBitWidth;
+	width[ColumnField] = colHighBitWidth;
+
+	// each burst will contain JEDEC_DATA_BUS_BITS/8 bytes of data and a
+	// transaction covers the low column bits, so those are thrown away before
+	// mapping the other bits
+	unsigned shift = byteOffsetWidth + colLowBitWidth;
+	for (size_t i=0;i<NUM_FIELDS;i++)
+	{
+		Field field = order[i];
+		layout.shift[field] = shift;
+		layout.mask[field] = (1ULL << width[field]) - 1;
+		layout.bits[field] = layout.mask[field] << shift;
+		shift += width[field];
+	}
+	return layout;
+}
 
+AddressMapping::Field AddressMapping::parseField(const string &name, const string &description)
+{
+	if (name == "ch")
+	{
+		return ChannelField;
 	}
-	// clone of scheme 5, but channel moved to lower bits
-	/*
-	else if (addressMappingScheme == Scheme7)
+	else if (name == "ra")
 	{
-		//row:col:rank:bank:chan
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> channelBitWidth;
-		tempB = physicalAddr << channelBitWidth;
-		newTransactionChan = tempA ^ tempB;
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> bankBitWidth;
-		tempB = physicalAddr << bankBitWidth;
-		newTransactionBank = tempA ^ tempB;
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> rankBitWidth;
-		tempB = physicalAddr << rankBitWidth;
-		newTransactionRank = tempA ^ tempB;
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> colHighBitWidth;
-		tempB = physicalAddr << colHighBitWidth;
-		newTransactionColumn = tempA ^ tempB;
-
-		tempA = physicalAddr;
-		physicalAddr = physicalAddr >> rowBitWidth;
-		tempB = physicalAddr << rowBitWidth;
-		newTransactionRow = tempA ^ tempB;
+		return RankField;
+	}
+	else if (name == "ba")
+	{
+		return BankField;
+	}
+	else if (name == "ro")
+	{
+		return RowField;
+	}
+	else if (name == "co")
+	{
+		return ColumnField;
+	}
+	ERROR("== Error - Unknown field '"<<name<<"' in address mapping '"<<description<<"', valid fields are ch, ra, ba, ro and co");
+	exit(-1);
+}
 
+const AddressMapping::TierLayout &AddressMapping::findTier(uint64_t physicalAddress) const
+{
+	if (physicalAddress < nvm.base)
+	{
+		return dram;
 	}
-	*/
-	else
+	if (physicalAddress >= nvm.base + nvm.size)
 	{
-		ERROR("== Error - Unknown Address Mapping Scheme");
+		ERROR("== Error - Unknown Physical Address, physical address is larger than total storage.");
 		exit(-1);
 	}
-	if (DEBUG_ADDR_MAP)
+	return nvm;
+}
+
+static inline void extractFields(uint64_t address, const unsigned *shift, const uint64_t *mask, unsigned *fields, size_t numFields)
+{
+	for (size_t i=0;i<numFields;i++)
 	{
-		DEBUG("Mapped Ch="<<newTransactionChan<<" Rank="<<newTransactionRank
-				<<" Bank="<<newTransactionBank<<" Row="<<newTransactionRow
-				<<" Col="<<newTransactionColumn<<"\n"); 
+		fields[i] = (address >> shift[i]) & mask[i];
 	}
+}
 
+#ifdef ADDRESS_MAPPING_PEXT
+__attribute__((target("bmi2")))
+static void extractFieldsPext(uint64_t address, const uint64_t *bits, unsigned *fields, size_t numFields)
+{
+	for (size_t i=0;i<numFields;i++)
+	{
+		fields[i] = _pext_u64(address, bits[i]);
+	}
+}
+#endif
+
+void AddressMapping::decode(uint64_t physicalAddress, DecodedAddress &decoded) const
+{
+	decode(&physicalAddress, 1, &decoded);
+}
+
+void AddressMapping::decode(const uint64_t *physicalAddresses, size_t count, DecodedAddress *decoded) const
+{
+	for (size_t i=0;i<count;i++)
+	{
+		const TierLayout &tier = findTier(physicalAddresses[i]);
+		uint64_t address = physicalAddresses[i] - tier.base;
+		unsigned fields[NUM_FIELDS];
+#ifdef ADDRESS_MAPPING_PEXT
+		if (usePext)
+		{
+			extractFieldsPext(address, tier.bits, fields, NUM_FIELDS);
+		}
+		else
+#endif
+		{
+			extractFields(address, tier.shift, tier.mask, fields, NUM_FIELDS);
+		}
+		if (tier.hasXor)
+		{
+			unsigned raw[NUM_FIELDS];
+			for (size_t j=0;j<NUM_FIELDS;j++)
+			{
+				raw[j] = fields[j];
+			}
+			for (size_t j=0;j<NUM_FIELDS;j++)
+			{
+				for (size_t k=0;k<NUM_FIELDS;k++)
+				{
+					if (tier.xorFields[j] & (1 << k))
+					{
+						fields[j] ^= raw[k] & tier.mask[j];
+					}
+				}
+			}
+		}
+		decoded[i].channel = tier.firstChannel + fields[ChannelField];
+		decoded[i].rank = fields[RankField];
+		decoded[i].bank = fields[BankField];
+		decoded[i].row = fields[RowField];
+		decoded[i].column = fields[ColumnField];
+	}
 }
 };
@@ -27,13 +27,74 @@
 *  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 *********************************************************************************/
+
+
+
 #ifndef ADDRESS_MAPPING_H
 #define ADDRESS_MAPPING_H
+
+//AddressMapping.h
+//
+//Header file for the physical address to channel/rank/bank/row/column mapping
+//
+
 #include "IniReader.h"
+
 namespace DRAMSim
 {
-  class IniReader;
-	void addressMapping(uint64_t physicalAddress, unsigned &channel, unsigned &rank, unsigned &bank, unsigned &row, unsigned &col, std::vector<IniReader*>iniReader);
+//where a physical address lives
+struct DecodedAddress
+{
+	unsigned channel;
+	unsigned rank;
+	unsigned bank;
+	unsigned row;
+	unsigned column;
+};
+
+//decodes addresses with the bit layout of each memory type worked out once
+//  from its ini, so a decode is a few shifts and masks (or PEXTs)
+class AddressMapping
+{
+public:
+	AddressMapping(const vector<IniReader*> &allIniReaders);
+	void decode(uint64_t physicalAddress, DecodedAddress &decoded) const;
+	//decodes count addresses at once
+	void decode(const uint64_t *physicalAddresses, size_t count, DecodedAddress *decoded) const;
+
+private:
+	enum Field
+	{
+		ChannelField,
+		RankField,
+		BankField,
+		RowField,
+		ColumnField,
+		NUM_FIELDS
+	};
+	//the bits of each field in an address relative to the start of the memory type
+	struct TierLayout
+	{
+		unsigned firstChannel;
+		uint64_t base;
+		uint64_t size;
+		unsigned shift[NUM_FIELDS];
+		uint64_t mask[NUM_FIELDS];
+		//mask[i] << shift[i], for PEXT
+		uint64_t bits[NUM_FIELDS];
+		//one bit per field whose low bits are XORed into field i
+		unsigned xorFields[NUM_FIELDS];
+		bool hasXor;
+	};
+
+	const TierLayout &findTier(uint64_t physicalAddress) const;
+	static TierLayout buildLayout(IniReader *tier, unsigned firstChannel, uint64_t base);
+	static Field parseField(const string &name, const string &description);
+
+	TierLayout dram;
+	TierLayout nvm;
+	bool usePext;
+};
 }
 
 #endif
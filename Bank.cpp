@@ -41,7 +41,6 @@ using namespace DRAMSim;
 
 Bank::Bank(ostream &dramsim_log_,IniReader * iniReader_):
     iniReader(iniReader_),
-		currentState(dramsim_log_), 
 		rowEntries(iniReader_->NUM_COLS),
 		dramsim_log(dramsim_log_)
 {}
@@ -80,6 +79,7 @@ Bank::DataStruct *Bank::searchForRow(unsigned row, DataStruct *head)
 	return NULL;
 }
 
+#ifndef NO_STORAGE
 void Bank::read(BusPacket *busPacket)
 {
 	DataStruct *rowHeadNode = rowEntries[busPacket->column];
@@ -137,9 +137,10 @@ void Bank::write(const BusPacket *busPacket)
 		if (DEBUG_BANKS)
 		{
 			PRINTN(" -- Bank "<<busPacket->bank<<" writing to physical address 0x" << hex << busPacket->physicalAddress<<dec<<":");
-			busPacket->printData();
+			busPacket->printData(dramsim_log);
 			PRINT("");
 		}
 	}
 }
+#endif
 
@@ -64,12 +64,13 @@ class Bank
 public:
 	//functions
 	Bank(ostream &dramsim_log_,IniReader * iniReader);
+#ifndef NO_STORAGE
 	void read(BusPacket *busPacket);
 	void write(const BusPacket *busPacket);
+#endif
 
 	//fields
   IniReader * iniReader;
-	BankState currentState;
 
 private:
 	// private member
@@ -45,21 +45,129 @@
 using namespace std;
 using namespace DRAMSim;
 
+//the kernels below get an avx2 build next to the plain one and the loader
+//  picks whichever the host supports; avx2 has no unsigned 64-bit max, so
+//  the compiler emulates it with a compare and blend
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+#define BANKSTATE_KERNEL __attribute__((target_clones("avx2","default")))
+#else
+#define BANKSTATE_KERNEL
+#endif
+
+//lanes[i] = max(lanes[i], cycle)
+BANKSTATE_KERNEL
+static void raiseLanes(uint64_t * __restrict lanes, size_t n, uint64_t cycle)
+{
+	for (size_t i=0;i<n;i++)
+	{
+		lanes[i] = max(lanes[i], cycle);
+	}
+}
+
 //All banks start precharged
-BankState::BankState(ostream &dramsim_log_):
-		dramsim_log(dramsim_log_),
-		currentBankState(Idle),
-		openRowAddress(0),
-		nextRead(0),
-		nextWrite(0),
-		nextActivate(0),
-		nextPrecharge(0),
-		nextPowerUp(0),
-		lastCommand(READ),
-		stateChangeCountdown(0)
+BankStateTable::BankStateTable(unsigned numRanks_, unsigned numBanks_) :
+		numBanks(numBanks_),
+		currentBankState(numRanks_*numBanks_, Idle),
+		openRowAddress(numRanks_*numBanks_, 0),
+		nextRead(numRanks_*numBanks_, 0),
+		nextWrite(numRanks_*numBanks_, 0),
+		nextActivate(numRanks_*numBanks_, 0),
+		nextPrecharge(numRanks_*numBanks_, 0),
+		nextPowerUp(numRanks_*numBanks_, 0),
+		lastCommand(numRanks_*numBanks_, READ),
+		nextStateChange(numRanks_*numBanks_, 0),
+		rankSince(numRanks_*numBanks_, 0),
+		openSince(numRanks_*numBanks_, UINT64_MAX),
+		rankEvents(numRanks_*2)
 {}
 
-void BankState::print()
+void BankStateTable::delayColumnAccesses(unsigned rank, uint64_t readCycle, uint64_t writeCycle)
+{
+	size_t first = rank * numBanks;
+	raiseLanes(&nextRead[first], numBanks, readCycle);
+	raiseLanes(&nextWrite[first], numBanks, writeCycle);
+}
+
+
+void BankStateTable::delayActivates(unsigned rank, unsigned bank, uint64_t cycle)
+{
+	size_t first = rank * numBanks;
+	uint64_t own = nextActivate[first + bank];
+	raiseLanes(&nextActivate[first], numBanks, cycle);
+	nextActivate[first + bank] = own;
+}
+
+//only the latest command of each kind needs to be kept: a later command of the
+//  same kind sets later bounds
+void BankStateTable::issueColumnAccess(unsigned rank, ColumnKind kind, uint64_t cycle, uint64_t rankRead, uint64_t rankWrite,
+                                       uint64_t otherRead, uint64_t otherWrite)
+{
+	rankEvents[rank*2 + kind] = ColumnEvent(cycle, rankRead, rankWrite);
+	ChannelEvents &events = channelEvents[kind];
+	if (events.latestRank != rank)
+	{
+		events.other = events.latest;
+	}
+	events.latest = ColumnEvent(cycle, otherRead, otherWrite);
+	events.latestRank = rank;
+}
+
+uint64_t BankStateTable::boundColumnAccess(unsigned rank, size_t i, uint64_t ColumnEvent::*bound) const
+{
+	uint64_t next = 0;
+	for (unsigned kind=0;kind<2;kind++)
+	{
+		const ColumnEvent &own = rankEvents[rank*2 + kind];
+		if (own.cycle > rankSince[i])
+		{
+			next = max(next, own.*bound);
+		}
+		const ChannelEvents &events = channelEvents[kind];
+		const ColumnEvent &other = events.latestRank != rank ? events.latest : events.other;
+		if (other.cycle > openSince[i])
+		{
+			next = max(next, other.*bound);
+		}
+	}
+	return next;
+}
+
+uint64_t BankStateTable::getNextRead(unsigned rank, unsigned bank) const
+{
+	size_t i = rank * numBanks + bank;
+	return max(nextRead[i], boundColumnAccess(rank, i, &ColumnEvent::nextRead));
+}
+
+uint64_t BankStateTable::getNextWrite(unsigned rank, unsigned bank) const
+{
+	size_t i = rank * numBanks + bank;
+	return max(nextWrite[i], boundColumnAccess(rank, i, &ColumnEvent::nextWrite));
+}
+
+void BankStateTable::setColumnAccesses(unsigned rank, unsigned bank, uint64_t cycle, uint64_t next)
+{
+	size_t i = rank * numBanks + bank;
+	nextRead[i] = next;
+	nextWrite[i] = next;
+	rankSince[i] = cycle;
+	openSince[i] = cycle;
+}
+
+void BankStateTable::openRow(unsigned rank, unsigned bank, uint64_t cycle)
+{
+	openSince[rank * numBanks + bank] = cycle;
+}
+
+//the bounds the other ranks put on the bank while it was open stay with it
+void BankStateTable::closeRow(unsigned rank, unsigned bank)
+{
+	size_t i = rank * numBanks + bank;
+	nextRead[i] = getNextRead(rank, bank);
+	nextWrite[i] = getNextWrite(rank, bank);
+	openSince[i] = UINT64_MAX;
+}
+
+void BankState::print(ostream &dramsim_log)
 {
 	PRINT(" == Bank State ");
 	if (currentBankState == Idle)
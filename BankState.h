@@ -45,6 +45,9 @@
 
 #include "SystemConfiguration.h"
 #include "BusPacket.h"
+#include <vector>
+
+using std::vector;
 
 namespace DRAMSim
 {
@@ -57,25 +60,149 @@ enum CurrentBankState
 	PowerDown
 };
 
+//the state of one bank, a view of its slot in a BankStateTable
 class BankState
 {
-	ostream &dramsim_log; 
 public:
 	//Fields
-	CurrentBankState currentBankState;
-	unsigned openRowAddress;
-	uint64_t nextRead;
-	uint64_t nextWrite;
-	uint64_t nextActivate;
-	uint64_t nextPrecharge;
-	uint64_t nextPowerUp;
+	CurrentBankState &currentBankState;
+	unsigned &openRowAddress;
+	//the bank's own bounds, BankStateTable::getNextRead()/getNextWrite() add
+	//  the ones kept in the rank and channel registers
+	uint64_t &nextRead;
+	uint64_t &nextWrite;
+	uint64_t &nextActivate;
+	uint64_t &nextPrecharge;
+	uint64_t &nextPowerUp;
+
+	BusPacketType &lastCommand;
+	//cycle of the implicit state change the last command is due for, 0 if none
+	uint64_t &nextStateChange;
+
+	//Functions
+	BankState(CurrentBankState &currentBankState_, unsigned &openRowAddress_, uint64_t &nextRead_, uint64_t &nextWrite_,
+	          uint64_t &nextActivate_, uint64_t &nextPrecharge_, uint64_t &nextPowerUp_, BusPacketType &lastCommand_,
+	          uint64_t &nextStateChange_) :
+			currentBankState(currentBankState_),
+			openRowAddress(openRowAddress_),
+			nextRead(nextRead_),
+			nextWrite(nextWrite_),
+			nextActivate(nextActivate_),
+			nextPrecharge(nextPrecharge_),
+			nextPowerUp(nextPowerUp_),
+			lastCommand(lastCommand_),
+			nextStateChange(nextStateChange_)
+	{}
+	void print(ostream &dramsim_log);
+};
 
-	BusPacketType lastCommand;
-	unsigned stateChangeCountdown;
+//bank states of a channel kept as one array per field, with the banks of a
+//  rank next to each other, so that the timing constraints a command puts on
+//  many banks at once are applied with vector instructions
+//
+//a column command constrains the reads and writes of every bank of its rank,
+//  and of every bank of the other ranks that has a row open. Rather than
+//  pushing those constraints into each bank, the table can keep them in rank
+//  and channel registers that getNextRead()/getNextWrite() fold in
+class BankStateTable
+{
+public:
+	enum ColumnKind
+	{
+		ColumnRead,
+		ColumnWrite
+	};
+
+	//the banks of one rank
+	class RankView
+	{
+	public:
+		RankView(BankStateTable &table_, unsigned rank) :
+				table(table_),
+				first(rank * table_.numBanks)
+		{}
+		BankState operator[](size_t bank) const
+		{
+			return table.getBank(first + bank);
+		}
+	private:
+		BankStateTable &table;
+		size_t first;
+	};
 
 	//Functions
-	BankState(ostream &dramsim_log_);
-	void print();
+	BankStateTable(unsigned numRanks_, unsigned numBanks_);
+	RankView operator[](size_t rank)
+	{
+		return RankView(*this, rank);
+	}
+	BankState getBank(size_t i)
+	{
+		return BankState(currentBankState[i], openRowAddress[i], nextRead[i], nextWrite[i], nextActivate[i],
+		                 nextPrecharge[i], nextPowerUp[i], lastCommand[i], nextStateChange[i]);
+	}
+
+	//every bank of rank can't be read or written before the given cycles
+	void delayColumnAccesses(unsigned rank, uint64_t readCycle, uint64_t writeCycle);
+	//every bank of rank other than bank can't be activated before cycle
+	void delayActivates(unsigned rank, unsigned bank, uint64_t cycle);
+
+	//a column command issued to rank at cycle: the banks of rank can't be read
+	//  or written before rankRead/rankWrite, the open banks of the other ranks
+	//  before otherRead/otherWrite
+	void issueColumnAccess(unsigned rank, ColumnKind kind, uint64_t cycle, uint64_t rankRead, uint64_t rankWrite,
+	                       uint64_t otherRead, uint64_t otherWrite);
+	//nextRead/nextWrite of a bank including the rank and channel registers
+	uint64_t getNextRead(unsigned rank, unsigned bank) const;
+	uint64_t getNextWrite(unsigned rank, unsigned bank) const;
+	//sets nextRead and nextWrite of a bank to next, dropping what the column
+	//  commands issued up to cycle put on it
+	void setColumnAccesses(unsigned rank, unsigned bank, uint64_t cycle, uint64_t next);
+	//a bank opens a row at cycle, or closes it
+	void openRow(unsigned rank, unsigned bank, uint64_t cycle);
+	void closeRow(unsigned rank, unsigned bank);
+
+private:
+	//the last column command of a kind and the bounds it set
+	struct ColumnEvent
+	{
+		uint64_t cycle;
+		uint64_t nextRead;
+		uint64_t nextWrite;
+		ColumnEvent() : cycle(0), nextRead(0), nextWrite(0) {}
+		ColumnEvent(uint64_t cycle_, uint64_t nextRead_, uint64_t nextWrite_) :
+				cycle(cycle_), nextRead(nextRead_), nextWrite(nextWrite_) {}
+	};
+	//the last column command of a kind on the channel, and the last one to a
+	//  rank other than the rank of that command
+	struct ChannelEvents
+	{
+		ColumnEvent latest;
+		unsigned latestRank;
+		ColumnEvent other;
+		ChannelEvents() : latestRank(0) {}
+	};
+
+	uint64_t boundColumnAccess(unsigned rank, size_t i, uint64_t ColumnEvent::*bound) const;
+
+	unsigned numBanks;
+
+	vector<CurrentBankState> currentBankState;
+	vector<unsigned> openRowAddress;
+	vector<uint64_t> nextRead;
+	vector<uint64_t> nextWrite;
+	vector<uint64_t> nextActivate;
+	vector<uint64_t> nextPrecharge;
+	vector<uint64_t> nextPowerUp;
+	vector<BusPacketType> lastCommand;
+	vector<uint64_t> nextStateChange;
+
+	//rank events count for a bank if they are later than its rankSince, channel
+	//  events from other ranks if later than its openSince
+	vector<uint64_t> rankSince;
+	vector<uint64_t> openSince;
+	vector<ColumnEvent> rankEvents;
+	ChannelEvents channelEvents[2];
 };
 }
 
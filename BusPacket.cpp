@@ -47,15 +47,18 @@ using namespace std;
 
 BusPacket::BusPacket(BusPacketType packtype, uint64_t physicalAddr, 
 		unsigned col, unsigned rw, unsigned r, unsigned b, void *dat, 
-		ostream &dramsim_log_) :
-	dramsim_log(dramsim_log_),
+		uint32_t transactionID_, unsigned source_) :
+	physicalAddress(physicalAddr),
 	busPacketType(packtype),
+	rank(r),
+	bank(b),
 	column(col),
 	row(rw),
-	bank(b),
-	rank(r),
-	physicalAddress(physicalAddr),
-	data(dat)
+	transactionID(transactionID_),
+	source(source_)
+#ifndef NO_STORAGE
+	, data(dat)
+#endif
 {}
 
 void BusPacket::print(uint64_t currentClockCycle, bool dataStart)
@@ -99,7 +102,7 @@ void BusPacket::print(uint64_t currentClockCycle, bool dataStart)
 		}
 	}
 }
-void BusPacket::print()
+void BusPacket::print(ostream &dramsim_log)
 {
 	if (this == NULL) //pointer use makes this a necessary precaution
 	{
@@ -131,8 +134,8 @@ void BusPacket::print()
 			PRINT("BP [REF] pa[0x"<<hex<<physicalAddress<<dec<<"] r["<<rank<<"] b["<<bank<<"] row["<<row<<"] col["<<column<<"]");
 			break;
 		case DATA:
-			PRINTN("BP [DATA] pa[0x"<<hex<<physicalAddress<<dec<<"] r["<<rank<<"] b["<<bank<<"] row["<<row<<"] col["<<column<<"] data["<<data<<"]=");
-			printData();
+			PRINTN("BP [DATA] pa[0x"<<hex<<physicalAddress<<dec<<"] r["<<rank<<"] b["<<bank<<"] row["<<row<<"] col["<<column<<"] data["<<getData()<<"]=");
+			printData(dramsim_log);
 			PRINT("");
 			break;
 		default:
@@ -142,8 +145,9 @@ void BusPacket::print()
 	}
 }
 
-void BusPacket::printData() const 
+void BusPacket::printData(ostream &dramsim_log) const 
 {
+	void *data = getData();
 	if (data == NULL)
 	{
 		PRINTN("NO DATA");
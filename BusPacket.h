@@ -51,26 +51,50 @@ enum BusPacketType
 	DATA
 };
 
+//widths of the packed coordinates of a packet, every channel is checked to
+//  fit them when it is set up
+#define BUSPACKET_RANK_BITS 6
+#define BUSPACKET_BANK_BITS 6
+#define BUSPACKET_COLUMN_BITS 16
+//requests carry the id of the source (core, thread or stream) that made them
+#define BUSPACKET_SOURCE_BITS 8
+
+//Packets are plain data of 24 bytes (without storage) so that the queues of
+//  in-flight commands stay dense; anything that logs one passes in the log
+//  of its memory system.
 class BusPacket
 {
 	BusPacket();
-	ostream &dramsim_log; 
 public:
 	//Fields
-	BusPacketType busPacketType;
-	unsigned column;
-	unsigned row;
-	unsigned bank;
-	unsigned rank;
 	uint64_t physicalAddress;
+	BusPacketType busPacketType : 4;
+	unsigned rank : BUSPACKET_RANK_BITS;
+	unsigned bank : BUSPACKET_BANK_BITS;
+	unsigned column : BUSPACKET_COLUMN_BITS;
+	unsigned row;
+	//id of the transaction the packet was made for, 0 for refreshes and precharges
+	uint32_t transactionID;
+	unsigned source : BUSPACKET_SOURCE_BITS;
+#ifndef NO_STORAGE
 	void *data;
+#endif
 
 	//Functions
-	BusPacket(BusPacketType packtype, uint64_t physicalAddr, unsigned col, unsigned rw, unsigned r, unsigned b, void *dat, ostream &dramsim_log_);
+	BusPacket(BusPacketType packtype, uint64_t physicalAddr, unsigned col, unsigned rw, unsigned r, unsigned b, void *dat, uint32_t transactionID_=0, unsigned source_=0);
 
-	void print();
+	//NULL without storage
+	void *getData() const
+	{
+#ifndef NO_STORAGE
+		return data;
+#else
+		return NULL;
+#endif
+	}
+	void print(ostream &dramsim_log);
 	void print(uint64_t currentClockCycle, bool dataStart);
-	void printData() const;
+	void printData(ostream &dramsim_log) const;
 
 };
 }
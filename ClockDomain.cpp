@@ -89,6 +89,39 @@ namespace ClockDomain
 
 
 
+	// Only the distance counter2-counter1 carries state between updates: each
+	// update adds clock1 to it and fires as few callbacks (each adding clock2)
+	// as needed to keep it non-negative. n updates therefore fire
+	// ceil((n*clock1 - distance) / clock2) callbacks in total.
+	uint64_t ClockDomainCrosser::updatesWithin(uint64_t maxCallbacks)
+	{
+		if (clock1 == clock2)
+		{
+			return maxCallbacks;
+		}
+		uint64_t distance = counter2 - counter1;
+		if (maxCallbacks > (UINT64_MAX - distance) / clock2)
+		{
+			return UINT64_MAX;
+		}
+		return (maxCallbacks * clock2 + distance) / clock1;
+	}
+
+	uint64_t ClockDomainCrosser::skip(uint64_t n)
+	{
+		if (clock1 == clock2)
+		{
+			return n;
+		}
+		uint64_t distance = counter2 - counter1;
+		uint64_t advance = n * clock1;
+		uint64_t callbacks = advance > distance ? (advance - distance + clock2 - 1) / clock2 : 0;
+
+		counter1 = 0;
+		counter2 = distance + callbacks * clock2 - advance;
+		return callbacks;
+	}
+
 	void TestObj::cb()
 	{
 			cout << "In Callback\n";
@@ -10,6 +10,7 @@ namespace ClockDomain
     class CallbackBase
     {
         public:
+        virtual ~CallbackBase() {}
         virtual ReturnT operator()() = 0;
     };
 
@@ -48,6 +49,11 @@ namespace ClockDomain
 		ClockDomainCrosser(uint64_t _clock1, uint64_t _clock2, ClockUpdateCB *_callback);
 		ClockDomainCrosser(double ratio, ClockUpdateCB *_callback);
 		void update();
+		//largest number of update() calls that fire at most maxCallbacks callbacks
+		uint64_t updatesWithin(uint64_t maxCallbacks);
+		//equivalent to n update() calls except that the callback is not invoked;
+		//  returns the number of callbacks those calls would have fired
+		uint64_t skip(uint64_t n);
 	};
 
 
@@ -43,15 +43,16 @@
 #include "CommandQueue.h"
 #include "MemoryController.h"
 #include <assert.h>
+#include <atomic>
 
 using namespace DRAMSim;
 
 
-extern uint64_t rowBufferHitCount_dram;
-extern uint64_t rowBufferHitCount_pcm;
+extern std::atomic<uint64_t> rowBufferHitCount_dram;
+extern std::atomic<uint64_t> rowBufferHitCount_pcm;
 
 
-CommandQueue::CommandQueue(vector< vector<BankState> > &states, ostream &dramsim_log_,IniReader * iniReader_) :
+CommandQueue::CommandQueue(BankStateTable &states, ostream &dramsim_log_,IniReader * iniReader_, TimingWheel &timingWheel_, ObjectPool<BusPacket> &busPacketPool_) :
 		dramsim_log(dramsim_log_),
     iniReader(iniReader_),
 		bankStates(states),
@@ -61,6 +62,10 @@ CommandQueue::CommandQueue(vector< vector<BankState> > &states, ostream &dramsim
 		nextRankPRE(0),
 		refreshRank(0),
 		refreshWaiting(false),
+		timingWheel(timingWheel_),
+		busPacketPool(busPacketPool_),
+		scheduler(Scheduler::create(iniReader_)),
+		enqueueCount(0),
 		sendAct(true)
 {
   if(iniReader->SystemType==TYPE_DRAM)
@@ -106,7 +111,7 @@ CommandQueue::CommandQueue(vector< vector<BankState> > &states, ostream &dramsim
 		//this loop will run only once for per-rank and NUM_BANKS times for per-rank-per-bank
 		for (size_t bank=0; bank<numBankQueues; bank++)
 		{
-			actualQueue	= BusPacket1D();
+			actualQueue	= BusPacket1D(iniReader->CMD_QUEUE_DEPTH);
 			perBankQueue.push_back(actualQueue);
 		}
 		queues.push_back(perBankQueue);
@@ -115,21 +120,28 @@ CommandQueue::CommandQueue(vector< vector<BankState> > &states, ostream &dramsim
 
 	//FOUR-bank activation window
 	//	this will count the number of activations within a given window
-	//	(decrementing counter)
 	//
-	//countdown vector will have decrementing counters starting at tFAW
-	//  when the 0th element reaches 0, remove it
-	tFAWCountdown.reserve(iniReader->NUM_RANKS);
-	for (size_t i=0;i<iniReader->NUM_RANKS;i++)
+	//every activate schedules its own expiry on the timing wheel, tFAW
+	//  cycles after it was issued
+	activateWindow = vector<unsigned>(iniReader->NUM_RANKS,0);
+
+	transactionRoom = vector<uint64_t>((iniReader->NUM_RANKS*iniReader->NUM_BANKS+63)/64, 0);
+	if (scheduler != NULL)
 	{
-		//init the empty vectors here so we don't seg fault later
-		tFAWCountdown.push_back(vector<unsigned>());
+		bankIndex = vector<BankIndex>(iniReader->NUM_RANKS*iniReader->NUM_BANKS);
+	}
+	for (size_t rank=0; rank<iniReader->NUM_RANKS; rank++)
+	{
+		for (size_t bank=0; bank<iniReader->NUM_BANKS; bank++)
+		{
+			updateTransactionRoom(rank, bank);
+		}
 	}
 }
 CommandQueue::~CommandQueue()
 {
 	//ERROR("COMMAND QUEUE destructor");
-	size_t bankMax = iniReader->NUM_RANKS;
+	size_t bankMax = iniReader->NUM_BANKS;
 	if (iniReader->queuingStructure == PerRank) {
 		bankMax = 1; 
 	}
@@ -137,13 +149,15 @@ CommandQueue::~CommandQueue()
 	{
 		for (size_t b=0; b<bankMax; b++) 
 		{
-			for (size_t i=0; i<queues[r][b].size(); i++)
+			BusPacket1D &queue = queues[r][b];
+			for (BusPacket1D::Handle i=queue.begin(); i!=queue.end(); i=queue.next(i))
 			{
-				delete(queues[r][b][i]);
+				busPacketPool.release(queue[i]);
 			}
-			queues[r][b].clear();
+			queue.clear();
 		}
 	}
+	delete scheduler;
 }
 //Adds a command to appropriate queue
 void CommandQueue::enqueue(BusPacket *newBusPacket)
@@ -175,31 +189,32 @@ void CommandQueue::enqueue(BusPacket *newBusPacket)
 		ERROR("== Error - Unknown queuing structure");
 		exit(0);
 	}
-}
 
-//Removes the next item from the command queue based on the system's
-//command scheduling policy
-bool CommandQueue::pop(BusPacket **busPacket)
-{
-	//this can be done here because pop() is called every clock cycle by the parent MemoryController
-	//	figures out the sliding window requirement for tFAW
-	//
-	//deal with tFAW book-keeping
-	//	each rank has it's own counter since the restriction is on a device level
-	for (size_t i=0;i<iniReader->NUM_RANKS;i++)
+	if (scheduler != NULL)
 	{
-		//decrement all the counters we have going
-		for (size_t j=0;j<tFAWCountdown[i].size();j++)
+		BusPacket1D &queue = getCommandQueue(rank, bank);
+		BankIndex &index = bankIndex[rank*iniReader->NUM_BANKS+bank];
+		QueuedCommand command = {queue.prev(queue.end()), currentClockCycle};
+		if (newBusPacket->busPacketType == ACTIVATE)
 		{
-			tFAWCountdown[i][j]--;
+			index.activates[newBusPacket->source][enqueueCount] = command;
 		}
-
-		//the head will always be the smallest counter, so check if it has reached 0
-		if (tFAWCountdown[i].size()>0 && tFAWCountdown[i][0]==0)
+		else
 		{
-			tFAWCountdown[i].erase(tFAWCountdown[i].begin());
+			index.rows[newBusPacket->row][enqueueCount] = command;
 		}
+		scheduler->enqueued(newBusPacket, enqueueCount, currentClockCycle);
+		enqueueCount++;
 	}
+	updateTransactionRoom(rank, bank);
+}
+
+//Removes the next item from the command queue based on the system's
+//command scheduling policy
+bool CommandQueue::pop(BusPacket **busPacket)
+{
+	//the tFAW windows that expire this cycle have already been closed by the
+	//	parent MemoryController through closeActivateWindow()
 
 	/* Now we need to find a packet to issue. When the code picks a packet, it will set
 		 *busPacket = [some eligible packet]
@@ -219,14 +234,24 @@ bool CommandQueue::pop(BusPacket **busPacket)
 			//look for an open bank
 			for (size_t b=0;b<iniReader->NUM_BANKS;b++)
 			{
-				vector<BusPacket *> &queue = getCommandQueue(refreshRank,b);
+				BusPacket1D &queue = getCommandQueue(refreshRank,b);
 				//checks to make sure that all banks are idle
 				if (bankStates[refreshRank][b].currentBankState == RowActive)
 				{
 					foundActiveOrTooEarly = true;
 					//if the bank is open, make sure there is nothing else
 					// going there before we close it
-					for (size_t j=0;j<queue.size();j++)
+					if (scheduler != NULL)
+					{
+						CommandsByAge::iterator hit;
+						if (findRowHit(refreshRank, b, hit) && isIssuable(queue[hit->second.handle]))
+						{
+							*busPacket = takeRowHit(refreshRank, b, hit);
+							sendingREF = true;
+						}
+						break;
+					}
+					for (BusPacket1D::Handle j=queue.begin();j!=queue.end();j=queue.next(j))
 					{
 						BusPacket *packet = queue[j];
 						if (packet->row == bankStates[refreshRank][b].openRowAddress &&
@@ -235,7 +260,7 @@ bool CommandQueue::pop(BusPacket **busPacket)
 							if (packet->busPacketType != ACTIVATE && isIssuable(packet))
 							{
 								*busPacket = packet;
-								queue.erase(queue.begin() + j);
+								queue.erase(j);
 								sendingREF = true;
 							}
 							break;
@@ -259,7 +284,7 @@ bool CommandQueue::pop(BusPacket **busPacket)
 			//	reset flags and rank pointer
 			if (!foundActiveOrTooEarly && bankStates[refreshRank][0].currentBankState != PowerDown)
 			{
-				*busPacket = new BusPacket(REFRESH, 0, 0, 0, refreshRank, 0, 0, dramsim_log);
+				*busPacket = new (busPacketPool.allocate()) BusPacket(REFRESH, 0, 0, 0, refreshRank, 0, 0);
 				refreshRank = -1;
 				refreshWaiting = false;
 				sendingREF = true;
@@ -272,9 +297,14 @@ bool CommandQueue::pop(BusPacket **busPacket)
 			bool foundIssuable = false;
 			unsigned startingRank = nextRank;
 			unsigned startingBank = nextBank;
-			do
+			if (scheduler != NULL)
 			{
-				vector<BusPacket *> &queue = getCommandQueue(nextRank, nextBank);
+				foundIssuable = popScheduled(busPacket);
+			}
+			//round robin over the queues otherwise
+			while (scheduler == NULL)
+			{
+				BusPacket1D &queue = getCommandQueue(nextRank, nextBank);
 				//make sure there is something in this queue first
 				//	also make sure a rank isn't waiting for a refresh
 				//	if a rank is waiting for a refesh, don't issue anything to it until the
@@ -285,17 +315,17 @@ bool CommandQueue::pop(BusPacket **busPacket)
 					{
 
 						//search from beginning to find first issuable bus packet
-						for (size_t i=0;i<queue.size();i++)
+						for (BusPacket1D::Handle i=queue.begin();i!=queue.end();i=queue.next(i))
 						{
 							if (isIssuable(queue[i]))
 							{
 								//check to make sure we aren't removing a read/write that is paired with an activate
-								if (i>0 && queue[i-1]->busPacketType==ACTIVATE &&
-										queue[i-1]->physicalAddress == queue[i]->physicalAddress)
+								if (i!=queue.begin() && queue[queue.prev(i)]->busPacketType==ACTIVATE &&
+										queue[queue.prev(i)]->physicalAddress == queue[i]->physicalAddress)
 									continue;
 
 								*busPacket = queue[i];
-								queue.erase(queue.begin()+i);
+								queue.erase(i);
 								foundIssuable = true;
 								break;
 							}
@@ -303,13 +333,13 @@ bool CommandQueue::pop(BusPacket **busPacket)
 					}
 					else
 					{
-						if (isIssuable(queue[0]))
+						if (isIssuable(queue.front()))
 						{
 
 							//no need to search because if the front can't be sent,
 							// then no chance something behind it can go instead
-							*busPacket = queue[0];
-							queue.erase(queue.begin());
+							*busPacket = queue.front();
+							queue.pop_front();
 							foundIssuable = true;
 						}
 					}
@@ -337,7 +367,6 @@ bool CommandQueue::pop(BusPacket **busPacket)
 					}
 				}
 			}
-			while (true);
 
 			//if we couldn't find anything to send, return false
 			if (!foundIssuable) return false;
@@ -358,33 +387,49 @@ bool CommandQueue::pop(BusPacket **busPacket)
 					sendREF = false;
 					bool closeRow = true;
 					//search for commands going to an open row
-					vector <BusPacket *> &refreshQueue = getCommandQueue(refreshRank,b);
+					BusPacket1D &refreshQueue = getCommandQueue(refreshRank,b);
 
-					for (size_t j=0;j<refreshQueue.size();j++)
+					if (scheduler != NULL)
 					{
-						BusPacket *packet = refreshQueue[j];
-						//if a command in the queue is going to the same row . . .
-						if (bankStates[refreshRank][b].openRowAddress == packet->row &&
-								b == packet->bank)
+						CommandsByAge::iterator hit;
+						if (findRowHit(refreshRank, b, hit))
 						{
-							// . . . and is not an activate . . .
-							if (packet->busPacketType != ACTIVATE)
+							closeRow = false;
+							if (isIssuable(refreshQueue[hit->second.handle]))
 							{
-								closeRow = false;
-								// . . . and can be issued . . .
-								if (isIssuable(packet))
-								{
-									//send it out
-									*busPacket = packet;
-									refreshQueue.erase(refreshQueue.begin()+j);
-									sendingREForPRE = true;
-								}
-								break;
+								*busPacket = takeRowHit(refreshRank, b, hit);
+								sendingREForPRE = true;
 							}
-							else //command is an activate
+						}
+					}
+					else
+					{
+						for (BusPacket1D::Handle j=refreshQueue.begin();j!=refreshQueue.end();j=refreshQueue.next(j))
+						{
+							BusPacket *packet = refreshQueue[j];
+							//if a command in the queue is going to the same row . . .
+							if (bankStates[refreshRank][b].openRowAddress == packet->row &&
+									b == packet->bank)
 							{
-								//if we've encountered another act, no other command will be of interest
-								break;
+								// . . . and is not an activate . . .
+								if (packet->busPacketType != ACTIVATE)
+								{
+									closeRow = false;
+									// . . . and can be issued . . .
+									if (isIssuable(packet))
+									{
+										//send it out
+										*busPacket = packet;
+										refreshQueue.erase(j);
+										sendingREForPRE = true;
+									}
+									break;
+								}
+								else //command is an activate
+								{
+									//if we've encountered another act, no other command will be of interest
+									break;
+								}
 							}
 						}
 					}
@@ -393,7 +438,7 @@ bool CommandQueue::pop(BusPacket **busPacket)
 					if (closeRow && currentClockCycle >= bankStates[refreshRank][b].nextPrecharge)
 					{
 						rowAccessCounters[refreshRank][b]=0;
-						*busPacket = new BusPacket(PRECHARGE, 0, 0, 0, refreshRank, b, 0, dramsim_log);
+						*busPacket = new (busPacketPool.allocate()) BusPacket(PRECHARGE, 0, 0, 0, refreshRank, b, 0);
 						sendingREForPRE = true;
 					}
 					break;
@@ -412,7 +457,7 @@ bool CommandQueue::pop(BusPacket **busPacket)
 			//	reset flags and rank pointer
 			if (sendREF && bankStates[refreshRank][0].currentBankState != PowerDown)
 			{
-				*busPacket = new BusPacket(REFRESH, 0, 0, 0, refreshRank, 0, 0, dramsim_log);
+				*busPacket = new (busPacketPool.allocate()) BusPacket(REFRESH, 0, 0, 0, refreshRank, 0, 0);
 				refreshRank = -1;
 				refreshWaiting = false;
 				sendingREForPRE = true;
@@ -424,21 +469,25 @@ bool CommandQueue::pop(BusPacket **busPacket)
 			unsigned startingRank = nextRank;
 			unsigned startingBank = nextBank;
 			bool foundIssuable = false;
-			do // round robin over queues
+			if (scheduler != NULL)
 			{
-				vector<BusPacket *> &queue = getCommandQueue(nextRank,nextBank);
+				foundIssuable = popScheduled(busPacket);
+			}
+			while (scheduler == NULL) // round robin over queues
+			{
+				BusPacket1D &queue = getCommandQueue(nextRank,nextBank);
 				//make sure there is something there first
 				if (!queue.empty() && !((nextRank == refreshRank) && refreshWaiting))
 				{
 					//search from the beginning to find first issuable bus packet
-					for (size_t i=0;i<queue.size();i++)
+					for (BusPacket1D::Handle i=queue.begin();i!=queue.end();i=queue.next(i))
 					{
 						BusPacket *packet = queue[i];
 						if (isIssuable(packet))
 						{
 							//check for dependencies
 							bool dependencyFound = false;
-							for (size_t j=0;j<i;j++)
+							for (BusPacket1D::Handle j=queue.begin();j!=i;j=queue.next(j))
 							{
 								BusPacket *prevPacket = queue[j];
 								if (prevPacket->busPacketType != ACTIVATE &&
@@ -455,15 +504,17 @@ bool CommandQueue::pop(BusPacket **busPacket)
 
 							//if the bus packet before is an activate, that is the act that was
 							//	paired with the column access we are removing, so we have to remove
-							//	that activate as well (check i>0 because if i==0 then theres nothing before it)
-							if (i>0 && queue[i-1]->busPacketType == ACTIVATE)
+							//	that activate as well (check i isn't the front because then theres nothing before it)
+							if (i!=queue.begin() && queue[queue.prev(i)]->busPacketType == ACTIVATE)
 							{
+								BusPacket1D::Handle activate = queue.prev(i);
 								rowAccessCounters[(*busPacket)->rank][(*busPacket)->bank]++;
-								// i is being returned, but i-1 is being thrown away, so must delete it here 
-								delete (queue[i-1]);
+								// i is being returned, but the activate is being thrown away, so must delete it here 
+								busPacketPool.release(queue[activate]);
 
-								// remove both i-1 (the activate) and i (we've saved the pointer in *busPacket)
-								queue.erase(queue.begin()+i-1,queue.begin()+i+1);
+								// remove both the activate and i (we've saved the pointer in *busPacket)
+								queue.erase(activate);
+								queue.erase(i);
 								if(iniReader->SystemType==TYPE_DRAM)
 								{
 									rowBufferHitCount_dram++;
@@ -476,7 +527,7 @@ bool CommandQueue::pop(BusPacket **busPacket)
 							else // there's no activate before this packet
 							{
 								//or just remove the one bus packet
-								queue.erase(queue.begin()+i);
+								queue.erase(i);
 							}
 
 							foundIssuable = true;
@@ -506,7 +557,6 @@ bool CommandQueue::pop(BusPacket **busPacket)
 					}
 				}
 			}
-			while (true);
 
 			//if nothing was issuable, see if we can issue a PRE to an open bank
 			//	that has no other commands waiting
@@ -519,30 +569,17 @@ bool CommandQueue::pop(BusPacket **busPacket)
 
 				do // round robin over all ranks and banks
 				{
-					vector <BusPacket *> &queue = getCommandQueue(nextRankPRE, nextBankPRE);
-					bool found = false;
 					//check if bank is open
 					if (bankStates[nextRankPRE][nextBankPRE].currentBankState == RowActive)
 					{
-						for (size_t i=0;i<queue.size();i++)
-						{
-							//if there is something going to that bank and row, then we don't want to send a PRE
-							if (queue[i]->bank == nextBankPRE &&
-									queue[i]->row == bankStates[nextRankPRE][nextBankPRE].openRowAddress)
-							{
-								found = true;
-								break;
-							}
-						}
-
 						//if nothing found going to that bank and row or too many accesses have happend, close it
-						if (!found || rowAccessCounters[nextRankPRE][nextBankPRE]==iniReader->TOTAL_ROW_ACCESSES)
+						if (!rowWanted(nextRankPRE, nextBankPRE) || rowAccessCounters[nextRankPRE][nextBankPRE]==iniReader->TOTAL_ROW_ACCESSES)
 						{
 							if (currentClockCycle >= bankStates[nextRankPRE][nextBankPRE].nextPrecharge)
 							{
 								sendingPRE = true;
 								rowAccessCounters[nextRankPRE][nextBankPRE] = 0;
-								*busPacket = new BusPacket(PRECHARGE, 0, 0, 0, nextRankPRE, nextBankPRE, 0, dramsim_log);
+								*busPacket = new (busPacketPool.allocate()) BusPacket(PRECHARGE, 0, 0, 0, nextRankPRE, nextBankPRE, 0);
 								break;
 							}
 						}
@@ -571,22 +608,277 @@ bool CommandQueue::pop(BusPacket **busPacket)
 		nextRankAndBank(nextRank, nextBank);
 	}
 
-	//if its an activate, add a tfaw counter
+	//if its an activate, open a tFAW window
 	if ((*busPacket)->busPacketType==ACTIVATE)
 	{
-		tFAWCountdown[(*busPacket)->rank].push_back(iniReader->tFAW);
+		activateWindow[(*busPacket)->rank]++;
+		timingWheel.schedule(currentClockCycle + iniReader->tFAW, ACTIVATE_WINDOW_EXPIRY, (*busPacket)->rank, 0);
 	}
 
+	updateTransactionRoom((*busPacket)->rank, (*busPacket)->bank);
 	return true;
 }
 
 //check if a rank/bank queue has room for a certain number of bus packets
 bool CommandQueue::hasRoomFor(unsigned numberToEnqueue, unsigned rank, unsigned bank)
 {
-	vector<BusPacket *> &queue = getCommandQueue(rank, bank); 
+	BusPacket1D &queue = getCommandQueue(rank, bank); 
 	return (iniReader->CMD_QUEUE_DEPTH - queue.size() >= numberToEnqueue);
 }
 
+//recomputes the transactionRoom bits of the queue rank,bank goes to; all of
+//	the rank's banks share one queue under the per-rank structure
+void CommandQueue::updateTransactionRoom(unsigned rank, unsigned bank)
+{
+	bool room = hasRoomFor(2, rank, bank);
+	unsigned first = rank*iniReader->NUM_BANKS;
+	unsigned last = first + iniReader->NUM_BANKS;
+	if (iniReader->queuingStructure==PerRankPerBank)
+	{
+		first += bank;
+		last = first + 1;
+	}
+	for (unsigned i=first; i<last; i++)
+	{
+		if (room)
+		{
+			transactionRoom[i/64] |= 1ULL << (i%64);
+		}
+		else
+		{
+			transactionRoom[i/64] &= ~(1ULL << (i%64));
+		}
+	}
+}
+
+//whether anything queued goes to the row rank,bank has open
+bool CommandQueue::rowWanted(unsigned rank, unsigned bank)
+{
+	unsigned openRow = bankStates[rank][bank].openRowAddress;
+	if (scheduler != NULL)
+	{
+		//a queued activate always has its column access queued behind it
+		BankIndex &index = bankIndex[rank*iniReader->NUM_BANKS+bank];
+		return index.rows.find(openRow) != index.rows.end();
+	}
+	BusPacket1D &queue = getCommandQueue(rank, bank);
+	for (BusPacket1D::Handle i=queue.begin();i!=queue.end();i=queue.next(i))
+	{
+		if (queue[i]->bank == bank && queue[i]->row == openRow)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+BusPacket *CommandQueue::nextRead(unsigned rank, unsigned bank)
+{
+	BusPacket1D &queue = getCommandQueue(rank, bank);
+	if (scheduler != NULL)
+	{
+		//a scheduler may take the oldest access of any row first, so a read
+		//	queued behind writes to other rows can still be the next served
+		BankIndex &index = bankIndex[rank*iniReader->NUM_BANKS+bank];
+		BusPacket *read = NULL;
+		uint64_t readAge = 0;
+		for (map<unsigned, CommandsByAge>::iterator row=index.rows.begin(); row!=index.rows.end(); row++)
+		{
+			CommandsByAge::iterator oldest = row->second.begin();
+			BusPacket *packet = queue[oldest->second.handle];
+			if ((packet->busPacketType == READ || packet->busPacketType == READ_P) &&
+			        (read == NULL || oldest->first < readAge))
+			{
+				read = packet;
+				readAge = oldest->first;
+			}
+		}
+		return read;
+	}
+	bool activate = false;
+	for (BusPacket1D::Handle i=queue.begin();i!=queue.end();i=queue.next(i))
+	{
+		if (queue[i]->bank != bank)
+		{
+			continue;
+		}
+		if (!activate)
+		{
+			if (queue[i]->busPacketType != ACTIVATE)
+			{
+				return NULL;
+			}
+			activate = true;
+			continue;
+		}
+		//an activate always has its column access queued right behind it
+		if (queue[i]->busPacketType == READ || queue[i]->busPacketType == READ_P)
+		{
+			return queue[i];
+		}
+		return NULL;
+	}
+	return NULL;
+}
+
+//whether a write to the column is queued
+bool CommandQueue::writeQueued(unsigned rank, unsigned bank, unsigned row, unsigned column)
+{
+	BusPacket1D &queue = getCommandQueue(rank, bank);
+	for (BusPacket1D::Handle i=queue.begin();i!=queue.end();i=queue.next(i))
+	{
+		if ((queue[i]->busPacketType == WRITE || queue[i]->busPacketType == WRITE_P) &&
+		        queue[i]->bank == bank && queue[i]->row == row && queue[i]->column == column)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+//Hands the scheduler the commands that can go now and issues the one it
+//	picks: for each bank the oldest column access to its open row, and the
+//	oldest activate of each source. Only the oldest access to each row is a
+//	candidate, so accesses to one row keep their order and a read never passes
+//	a write to the same address. Ranks waiting for a refresh are left to the
+//	refresh logic.
+bool CommandQueue::popScheduled(BusPacket **busPacket)
+{
+	candidates.clear();
+	for (unsigned r=0;r<iniReader->NUM_RANKS;r++)
+	{
+		if (refreshWaiting && r == refreshRank)
+		{
+			continue;
+		}
+		for (unsigned b=0;b<iniReader->NUM_BANKS;b++)
+		{
+			BusPacket1D &queue = getCommandQueue(r,b);
+			map<unsigned, CommandsByAge> &activates = bankIndex[r*iniReader->NUM_BANKS+b].activates;
+			CommandsByAge::iterator hit;
+			if (findRowHit(r, b, hit) && isIssuable(queue[hit->second.handle]))
+			{
+				SchedulerCandidate candidate = {queue[hit->second.handle], hit->first, hit->second.enqueuedAt, true};
+				candidates.push_back(candidate);
+			}
+			//every activate of a bank waits on the same bank state, so if one
+			//	can't go, none can
+			if (activates.empty() || !isIssuable(queue[activates.begin()->second.begin()->second.handle]))
+			{
+				continue;
+			}
+			for (map<unsigned, CommandsByAge>::iterator source=activates.begin(); source!=activates.end(); source++)
+			{
+				CommandsByAge::iterator oldest = source->second.begin();
+				SchedulerCandidate candidate = {queue[oldest->second.handle], oldest->first, oldest->second.enqueuedAt, false};
+				candidates.push_back(candidate);
+			}
+		}
+	}
+	if (candidates.empty())
+	{
+		return false;
+	}
+
+	const SchedulerCandidate &chosen = candidates[scheduler->choose(candidates, currentClockCycle)];
+	unsigned rank = chosen.packet->rank;
+	unsigned bank = chosen.packet->bank;
+	if (chosen.rowHit)
+	{
+		CommandsByAge::iterator hit;
+		findRowHit(rank, bank, hit);
+		*busPacket = takeRowHit(rank, bank, hit);
+	}
+	else
+	{
+		*busPacket = takeActivate(rank, bank, chosen.packet->source);
+	}
+	return true;
+}
+
+//the oldest queued column access to the row rank,bank has open
+bool CommandQueue::findRowHit(unsigned rank, unsigned bank, CommandsByAge::iterator &hit)
+{
+	if (bankStates[rank][bank].currentBankState != RowActive)
+	{
+		return false;
+	}
+	BankIndex &index = bankIndex[rank*iniReader->NUM_BANKS+bank];
+	map<unsigned, CommandsByAge>::iterator row = index.rows.find(bankStates[rank][bank].openRowAddress);
+	if (row == index.rows.end())
+	{
+		return false;
+	}
+	hit = row->second.begin();
+	return true;
+}
+
+//takes the column access found by findRowHit() out of the queue, along with
+//	its activate if that hasn't been issued -- the row was opened for another
+//	access, so that activate isn't needed any more
+BusPacket *CommandQueue::takeRowHit(unsigned rank, unsigned bank, CommandsByAge::iterator hit)
+{
+	BusPacket1D &queue = getCommandQueue(rank, bank);
+	BankIndex &index = bankIndex[rank*iniReader->NUM_BANKS+bank];
+	BusPacket *packet = queue[hit->second.handle];
+	uint64_t age = hit->first;
+	queue.erase(hit->second.handle);
+	CommandsByAge &rowQueue = index.rows[packet->row];
+	rowQueue.erase(hit);
+	if (rowQueue.empty())
+	{
+		index.rows.erase(packet->row);
+	}
+	scheduler->removed(packet, age, true, currentClockCycle);
+
+	//the controller enqueues each activate right before its column access
+	map<unsigned, CommandsByAge>::iterator sourceActivates = index.activates.find(packet->source);
+	CommandsByAge::iterator activate;
+	if (sourceActivates != index.activates.end() &&
+	        (activate = sourceActivates->second.find(age-1)) != sourceActivates->second.end())
+	{
+		//only open page closes a row for having been hit too often; close page
+		//	has no precharge of its own to reset the count
+		if (iniReader->rowBufferPolicy == OpenPage)
+		{
+			rowAccessCounters[rank][bank]++;
+		}
+		scheduler->removed(queue[activate->second.handle], age-1, false, currentClockCycle);
+		busPacketPool.release(queue[activate->second.handle]);
+		queue.erase(activate->second.handle);
+		sourceActivates->second.erase(activate);
+		if (sourceActivates->second.empty())
+		{
+			index.activates.erase(sourceActivates);
+		}
+		if (iniReader->SystemType==TYPE_DRAM)
+		{
+			rowBufferHitCount_dram++;
+		}
+		else
+		{
+			rowBufferHitCount_pcm++;
+		}
+	}
+	return packet;
+}
+
+BusPacket *CommandQueue::takeActivate(unsigned rank, unsigned bank, unsigned source)
+{
+	BusPacket1D &queue = getCommandQueue(rank, bank);
+	map<unsigned, CommandsByAge> &activates = bankIndex[rank*iniReader->NUM_BANKS+bank].activates;
+	CommandsByAge &sourceActivates = activates[source];
+	BusPacket *packet = queue[sourceActivates.begin()->second.handle];
+	scheduler->removed(packet, sourceActivates.begin()->first, true, currentClockCycle);
+	queue.erase(sourceActivates.begin()->second.handle);
+	sourceActivates.erase(sourceActivates.begin());
+	if (sourceActivates.empty())
+	{
+		activates.erase(source);
+	}
+	return packet;
+}
+
 //prints the contents of the command queue
 void CommandQueue::print()
 {
@@ -596,10 +888,11 @@ void CommandQueue::print()
 		for (size_t i=0;i<iniReader->NUM_RANKS;i++)
 		{
 			PRINT(" = Rank " << i << "  size : " << queues[i][0].size() );
-			for (size_t j=0;j<queues[i][0].size();j++)
+			size_t j=0;
+			for (BusPacket1D::Handle h=queues[i][0].begin();h!=queues[i][0].end();h=queues[i][0].next(h))
 			{
-				PRINTN("    "<< j << "]");
-				queues[i][0][j]->print();
+				PRINTN("    "<< j++ << "]");
+				queues[i][0][h]->print(dramsim_log);
 			}
 		}
 	}
@@ -614,10 +907,11 @@ void CommandQueue::print()
 			{
 				PRINT("    Bank "<< j << "   size : " << queues[i][j].size() );
 
-				for (size_t k=0;k<queues[i][j].size();k++)
+				size_t k=0;
+				for (BusPacket1D::Handle h=queues[i][j].begin();h!=queues[i][j].end();h=queues[i][j].next(h))
 				{
-					PRINTN("       " << k << "]");
-					queues[i][j][k]->print();
+					PRINTN("       " << k++ << "]");
+					queues[i][j][h]->print(dramsim_log);
 				}
 			}
 		}
@@ -629,7 +923,7 @@ void CommandQueue::print()
  * don't always have a per bank queuing structure, sometimes the bank
  * argument is ignored (and the 0th index is returned 
  */
-vector<BusPacket *> &CommandQueue::getCommandQueue(unsigned rank, unsigned bank)
+CommandQueue::BusPacket1D &CommandQueue::getCommandQueue(unsigned rank, unsigned bank)
 {
 	if (iniReader->queuingStructure == PerRankPerBank)
 	{
@@ -650,69 +944,57 @@ vector<BusPacket *> &CommandQueue::getCommandQueue(unsigned rank, unsigned bank)
 //checks if busPacket is allowed to be issued
 bool CommandQueue::isIssuable(BusPacket *busPacket)
 {
+	return currentClockCycle >= issuableAt(busPacket);
+}
+
+//the cycle from which busPacket becomes issuable if no other command is issued
+//  and no bank changes state in the meantime, UINT64_MAX if it has to wait for that
+uint64_t CommandQueue::issuableAt(BusPacket *busPacket)
+{
+	BankState bankState = bankStates[busPacket->rank][busPacket->bank];
 	switch (busPacket->busPacketType)
 	{
 	case REFRESH:
 
 		break;
 	case ACTIVATE:
-		if ((bankStates[busPacket->rank][busPacket->bank].currentBankState == Idle ||
-		        bankStates[busPacket->rank][busPacket->bank].currentBankState == Refreshing) &&
-		        currentClockCycle >= bankStates[busPacket->rank][busPacket->bank].nextActivate &&
-		        tFAWCountdown[busPacket->rank].size() < 4)
+		if ((bankState.currentBankState == Idle ||
+		        bankState.currentBankState == Refreshing) &&
+		        activateWindow[busPacket->rank] < 4)
 		{
-			return true;
-		}
-		else
-		{
-			return false;
+			return bankState.nextActivate;
 		}
 		break;
 	case WRITE:
 	case WRITE_P:
-		if (bankStates[busPacket->rank][busPacket->bank].currentBankState == RowActive &&
-		        currentClockCycle >= bankStates[busPacket->rank][busPacket->bank].nextWrite &&
-		        busPacket->row == bankStates[busPacket->rank][busPacket->bank].openRowAddress &&
+		if (bankState.currentBankState == RowActive &&
+		        busPacket->row == bankState.openRowAddress &&
 		        rowAccessCounters[busPacket->rank][busPacket->bank] < iniReader->TOTAL_ROW_ACCESSES)
 		{
-			return true;
-		}
-		else
-		{
-			return false;
+			return bankStates.getNextWrite(busPacket->rank, busPacket->bank);
 		}
 		break;
 	case READ_P:
 	case READ:
-		if (bankStates[busPacket->rank][busPacket->bank].currentBankState == RowActive &&
-		        currentClockCycle >= bankStates[busPacket->rank][busPacket->bank].nextRead &&
-		        busPacket->row == bankStates[busPacket->rank][busPacket->bank].openRowAddress &&
+		if (bankState.currentBankState == RowActive &&
+		        busPacket->row == bankState.openRowAddress &&
 		        rowAccessCounters[busPacket->rank][busPacket->bank] < iniReader->TOTAL_ROW_ACCESSES)
 		{
-			return true;
-		}
-		else
-		{
-			return false;
+			return bankStates.getNextRead(busPacket->rank, busPacket->bank);
 		}
 		break;
 	case PRECHARGE:
-		if (bankStates[busPacket->rank][busPacket->bank].currentBankState == RowActive &&
-		        currentClockCycle >= bankStates[busPacket->rank][busPacket->bank].nextPrecharge)
-		{
-			return true;
-		}
-		else
+		if (bankState.currentBankState == RowActive)
 		{
-			return false;
+			return bankState.nextPrecharge;
 		}
 		break;
 	default:
 		ERROR("== Error - Trying to issue a crazy bus packet type : ");
-		busPacket->print();
+		busPacket->print(dramsim_log);
 		exit(0);
 	}
-	return false;
+	return UINT64_MAX;
 }
 
 //figures out if a rank's queue is empty
@@ -737,6 +1019,107 @@ bool CommandQueue::isEmpty(unsigned rank)
 	}
 }
 
+//First cycle at which pop() might issue something, assuming the bank states
+//  and tFAW windows don't change before then. Errs on the early side:
+//  a packet whose timing is met is treated as issuable now even if pop() would
+//  pass it over for ordering reasons.
+uint64_t CommandQueue::nextEventCycle()
+{
+	uint64_t next = UINT64_MAX;
+	//a scheduler is only ever offered the oldest access to each open row and
+	//	activates, which are ready all at once per bank; the others can't go
+	//	any earlier
+	for (size_t i=0;i<iniReader->NUM_RANKS && scheduler != NULL;i++)
+	{
+		for (size_t j=0;j<iniReader->NUM_BANKS;j++)
+		{
+			BusPacket1D &queue = getCommandQueue(i,j);
+			map<unsigned, CommandsByAge> &activates = bankIndex[i*iniReader->NUM_BANKS+j].activates;
+			CommandsByAge::iterator hit;
+			if (findRowHit(i, j, hit))
+			{
+				next = min(next, max(issuableAt(queue[hit->second.handle]), currentClockCycle));
+			}
+			if (!activates.empty() && !(refreshWaiting && i == refreshRank))
+			{
+				next = min(next, max(issuableAt(queue[activates.begin()->second.begin()->second.handle]), currentClockCycle));
+			}
+		}
+	}
+	for (size_t i=0;i<iniReader->NUM_RANKS && scheduler == NULL;i++)
+	{
+		for (size_t j=0;j<queues[i].size();j++)
+		{
+			BusPacket1D &queue = queues[i][j];
+			//with a queue per bank under close page only the head is ever considered
+			bool headOnly = iniReader->rowBufferPolicy == ClosePage && iniReader->queuingStructure == PerRankPerBank;
+			for (BusPacket1D::Handle k=queue.begin();k!=queue.end();k=queue.next(k))
+			{
+				//a rank waiting for a refresh only has its open rows drained
+				if (!(refreshWaiting && i == refreshRank && queue[k]->busPacketType == ACTIVATE))
+				{
+					next = min(next, max(issuableAt(queue[k]), currentClockCycle));
+				}
+				if (headOnly)
+				{
+					break;
+				}
+			}
+		}
+	}
+
+	//open page closes rows nobody is waiting for (and every open row of a rank
+	//  due for a refresh) with a PRE of its own
+	for (size_t i=0;i<iniReader->NUM_RANKS && iniReader->rowBufferPolicy == OpenPage;i++)
+	{
+		for (size_t j=0;j<iniReader->NUM_BANKS;j++)
+		{
+			if (bankStates[i][j].currentBankState != RowActive)
+			{
+				continue;
+			}
+			if ((refreshWaiting && i == refreshRank) ||
+			        rowAccessCounters[i][j] == iniReader->TOTAL_ROW_ACCESSES ||
+			        !rowWanted(i,j))
+			{
+				next = min(next, max(bankStates[i][j].nextPrecharge, currentClockCycle));
+			}
+		}
+	}
+
+	//a REF goes out once every bank of the rank is closed and has met tRP
+	if (refreshWaiting)
+	{
+		uint64_t refreshAt = currentClockCycle;
+		for (size_t b=0;b<iniReader->NUM_BANKS;b++)
+		{
+			if (bankStates[refreshRank][b].currentBankState == RowActive)
+			{
+				refreshAt = UINT64_MAX;
+				break;
+			}
+			refreshAt = max(refreshAt, bankStates[refreshRank][b].nextActivate);
+		}
+		if (bankStates[refreshRank][0].currentBankState != PowerDown)
+		{
+			next = min(next, refreshAt);
+		}
+	}
+	return next;
+}
+
+//does the work of that many pop() calls that issue nothing
+void CommandQueue::fastForward(uint64_t cycles)
+{
+	currentClockCycle += cycles;
+}
+
+//an activate to rank has left its tFAW window
+void CommandQueue::closeActivateWindow(unsigned rank)
+{
+	activateWindow[rank]--;
+}
+
 //tells the command queue that a particular rank is in need of a refresh
 void CommandQueue::needRefresh(unsigned rank)
 {
@@ -759,8 +1142,9 @@ void CommandQueue::nextRankAndBank(unsigned &rank, unsigned &bank)
 			}
 		}
 	}
-	//bank-then-rank round robin
-	else if (iniReader->schedulingPolicy == BankThenRankRoundRobin)
+	//bank-then-rank round robin, which is also the order the policies with a
+	//	scheduler look for rows to close in
+	else if (iniReader->schedulingPolicy == BankThenRankRoundRobin || scheduler != NULL)
 	{
 		bank++;
 		if (bank == iniReader->NUM_BANKS)
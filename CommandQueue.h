@@ -42,11 +42,16 @@
 //
 
 #include "BusPacket.h"
+#include "ObjectPool.h"
+#include "RingBuffer.h"
 #include "BankState.h"
 #include "Transaction.h"
 #include "SystemConfiguration.h"
 #include "SimulatorObject.h"
 #include "IniReader.h"
+#include "TimingWheel.h"
+#include "Scheduler.h"
+#include <map>
 
 using namespace std;
 
@@ -59,30 +64,67 @@ class CommandQueue : public SimulatorObject
 public:
   IniReader * iniReader;
 	//typedefs
-	typedef vector<BusPacket *> BusPacket1D;
+	typedef RingBuffer<BusPacket *> BusPacket1D;
 	typedef vector<BusPacket1D> BusPacket2D;
 	typedef vector<BusPacket2D> BusPacket3D;
 
 	//functions
-  CommandQueue(vector< vector<BankState> > &states, ostream &dramsim_log_,IniReader * iniReader_); 
+  CommandQueue(BankStateTable &states, ostream &dramsim_log_,IniReader * iniReader_, TimingWheel &timingWheel_, ObjectPool<BusPacket> &busPacketPool_); 
 	virtual ~CommandQueue(); 
 
 	void enqueue(BusPacket *newBusPacket);
 	bool pop(BusPacket **busPacket);
 	bool hasRoomFor(unsigned numberToEnqueue, unsigned rank, unsigned bank);
 	bool isIssuable(BusPacket *busPacket);
+	uint64_t issuableAt(BusPacket *busPacket);
 	bool isEmpty(unsigned rank);
+	uint64_t nextEventCycle();
+	void fastForward(uint64_t cycles);
 	void needRefresh(unsigned rank);
+	void closeActivateWindow(unsigned rank);
 	void print();
 	void update(); //SimulatorObject requirement
-	vector<BusPacket *> &getCommandQueue(unsigned rank, unsigned bank);
+	BusPacket1D &getCommandQueue(unsigned rank, unsigned bank);
+	//the oldest read the bank could serve next, or NULL: with a scheduler the
+	//	oldest read that is first in its row, otherwise the read of the oldest
+	//	command queued to the bank if that is its activate
+	BusPacket *nextRead(unsigned rank, unsigned bank);
+	bool writeQueued(unsigned rank, unsigned bank, unsigned row, unsigned column);
+	//one bit per bank, numbered rank*NUM_BANKS+bank, set while its queue has
+	//	room for the two commands of a transaction
+	const vector<uint64_t> &getTransactionRoom() const
+	{
+		return transactionRoom;
+	}
 
 	//fields
 	
 	BusPacket3D queues; // 3D array of BusPacket pointers
-	vector< vector<BankState> > &bankStates;
+	BankStateTable &bankStates;
 private:
 	void nextRankAndBank(unsigned &rank, unsigned &bank);
+	void updateTransactionRoom(unsigned rank, unsigned bank);
+	bool rowWanted(unsigned rank, unsigned bank);
+
+	//policies with a Scheduler: queue handles of a bank's commands by the
+	//	order they were enqueued in across the whole channel
+	struct QueuedCommand
+	{
+		BusPacket1D::Handle handle;
+		uint64_t enqueuedAt;
+	};
+	typedef map<uint64_t, QueuedCommand> CommandsByAge;
+	struct BankIndex
+	{
+		//activates, by the source of their request
+		map<unsigned, CommandsByAge> activates;
+		//column accesses, by the row they go to
+		map<unsigned, CommandsByAge> rows;
+	};
+	bool popScheduled(BusPacket **busPacket);
+	bool findRowHit(unsigned rank, unsigned bank, CommandsByAge::iterator &hit);
+	BusPacket *takeRowHit(unsigned rank, unsigned bank, CommandsByAge::iterator hit);
+	BusPacket *takeActivate(unsigned rank, unsigned bank, unsigned source);
 	//fields
 	unsigned nextBank;
 	unsigned nextRank;
@@ -93,8 +135,20 @@ private:
 	unsigned refreshRank;
 	bool refreshWaiting;
 
-	vector< vector<unsigned> > tFAWCountdown;
+	TimingWheel &timingWheel;
+	//refreshes and precharges are made here, redundant activates are dropped here
+	ObjectPool<BusPacket> &busPacketPool;
+	//activates issued to each rank within the last tFAW cycles
+	vector<unsigned> activateWindow;
 	vector< vector<unsigned> > rowAccessCounters;
+	vector<uint64_t> transactionRoom;
+	//picks among the ready commands bankIndex turns up, NULL for the round
+	//	robin policies
+	Scheduler *scheduler;
+	//one per bank numbered rank*NUM_BANKS+bank, only kept with a scheduler
+	vector<BankIndex> bankIndex;
+	uint64_t enqueueCount;
+	vector<SchedulerCandidate> candidates;
 
 	bool sendAct;
 };
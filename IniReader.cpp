@@ -126,7 +126,20 @@ IniReader::IniReader(unsigned SystemType_, unsigned totalStorage_):SystemType(Sy
   configMap[61]=DEFINE_FLOAT_PARAM(RowBufferReadEnergy,DEV_PARAM);
   configMap[62]=DEFINE_FLOAT_PARAM(RowBufferWriteEnergy,DEV_PARAM);
   
-  configMap[63]={"", NULL, UINT, SYS_PARAM, false}; // tracer value to signify end of list; if you delete it, epic fail will resul;
+  configMap[63]=DEFINE_UINT_PARAM(WRITE_QUEUE_DEPTH,SYS_PARAM);
+  configMap[64]=DEFINE_UINT_PARAM(WRITE_HIGH_WATERMARK,SYS_PARAM);
+  configMap[65]=DEFINE_UINT_PARAM(WRITE_LOW_WATERMARK,SYS_PARAM);
+
+  configMap[66]=DEFINE_UINT_PARAM(WRITE_ITERATIONS,DEV_PARAM);
+  configMap[67]=DEFINE_BOOL_PARAM(WRITE_PAUSING,DEV_PARAM);
+  configMap[68]=DEFINE_UINT_PARAM(WRITE_CANCEL_THRESHOLD,DEV_PARAM);
+  configMap[69]=DEFINE_UINT_PARAM(tSET,DEV_PARAM);
+  configMap[70]=DEFINE_UINT_PARAM(tRESET,DEV_PARAM);
+  configMap[71]=DEFINE_STRING_PARAM(WRITE_ITERATION_DISTRIBUTION,DEV_PARAM);
+  configMap[72]=DEFINE_FLOAT_PARAM(SetEnergy,DEV_PARAM);
+  configMap[73]=DEFINE_FLOAT_PARAM(ResetEnergy,DEV_PARAM);
+  
+  configMap[74]={"", NULL, UINT, SYS_PARAM, false}; // tracer value to signify end of list; if you delete it, epic fail will resul;
   
 }  
 
@@ -406,6 +419,57 @@ bool IniReader::CheckIfAllSet()
   //calculate WL and RL
   RL=CL+AL;
   WL=RL-1;
+	if (WRITE_QUEUE_DEPTH > 0 && !(WRITE_LOW_WATERMARK < WRITE_HIGH_WATERMARK && WRITE_HIGH_WATERMARK <= WRITE_QUEUE_DEPTH))
+	{
+		ERROR("WRITE_LOW_WATERMARK ("<<WRITE_LOW_WATERMARK<<") must be below WRITE_HIGH_WATERMARK ("<<WRITE_HIGH_WATERMARK
+		      <<"), which can't be above WRITE_QUEUE_DEPTH ("<<WRITE_QUEUE_DEPTH<<")");
+		return false;
+	}
+	if (WRITE_ITERATIONS == 0 || WRITE_ITERATIONS > tRP)
+	{
+		ERROR("WRITE_ITERATIONS ("<<WRITE_ITERATIONS<<") must be between 1 and tRP ("<<tRP<<")");
+		return false;
+	}
+	if (tSET == 0 && tRESET > 0)
+	{
+		ERROR("tRESET ("<<tRESET<<") needs tSET to be set as well");
+		return false;
+	}
+	//a comma separated weight for each number of iterations
+	writeIterationOdds.clear();
+	minWriteIterations = WRITE_ITERATIONS;
+	if (!WRITE_ITERATION_DISTRIBUTION.empty())
+	{
+		istringstream weights(WRITE_ITERATION_DISTRIBUTION);
+		string weight;
+		double total = 0.0;
+		while (getline(weights, weight, ','))
+		{
+			istringstream iss(weight);
+			double w;
+			if ((iss >> w).fail() || w < 0.0)
+			{
+				ERROR("WRITE_ITERATION_DISTRIBUTION ('"<<WRITE_ITERATION_DISTRIBUTION<<"') has a bad weight '"<<weight<<"'");
+				return false;
+			}
+			if (w > 0.0 && total == 0.0)
+			{
+				minWriteIterations = writeIterationOdds.size() + 1;
+			}
+			total += w;
+			writeIterationOdds.push_back(total);
+		}
+		if (writeIterationOdds.size() != WRITE_ITERATIONS || total == 0.0)
+		{
+			ERROR("WRITE_ITERATION_DISTRIBUTION ('"<<WRITE_ITERATION_DISTRIBUTION<<"') needs a weight for each of the "
+			      <<WRITE_ITERATIONS<<" WRITE_ITERATIONS, not all of them 0");
+			return false;
+		}
+		for (size_t i=0; i<writeIterationOdds.size(); i++)
+		{
+			writeIterationOdds[i] /= total;
+		}
+	}
 	return true;
 }
 void IniReader::InitEnumsFromStrings()
@@ -466,9 +530,18 @@ void IniReader::InitEnumsFromStrings()
 			DEBUG("ADDR SCHEME: 7");
 		}
 	}
+	else if (ADDRESS_MAPPING_SCHEME.find(':') != string::npos)
+	{
+		//a field order such as ro:ba^ro:ra:co:ch, checked by AddressMapping
+		addressMappingScheme = SchemeCustom;
+		if (DEBUG_INI_READER) 
+		{
+			DEBUG("ADDR SCHEME: "<<ADDRESS_MAPPING_SCHEME);
+		}
+	}
 	else
 	{
-		cout << "WARNING: unknown address mapping scheme '"<<ADDRESS_MAPPING_SCHEME<<"'; valid values are 'scheme1'...'scheme7'. Defaulting to scheme1"<<endl;
+		cout << "WARNING: unknown address mapping scheme '"<<ADDRESS_MAPPING_SCHEME<<"'; valid values are 'scheme1'...'scheme7' or a field order such as 'ro:ba^ro:ra:co:ch'. Defaulting to scheme1"<<endl;
 		addressMappingScheme = Scheme1;
 	}
 
@@ -532,9 +605,41 @@ void IniReader::InitEnumsFromStrings()
 			DEBUG("SCHEDULING: Bank Then Rank");
 		}
 	}
+	else if (SCHEDULING_POLICY == "fr_fcfs")
+	{
+		schedulingPolicy = FirstReadyFCFS;
+		if (DEBUG_INI_READER) 
+		{
+			DEBUG("SCHEDULING: FR-FCFS");
+		}
+	}
+	else if (SCHEDULING_POLICY == "atlas")
+	{
+		schedulingPolicy = Atlas;
+		if (DEBUG_INI_READER) 
+		{
+			DEBUG("SCHEDULING: ATLAS");
+		}
+	}
+	else if (SCHEDULING_POLICY == "bliss")
+	{
+		schedulingPolicy = Bliss;
+		if (DEBUG_INI_READER) 
+		{
+			DEBUG("SCHEDULING: BLISS");
+		}
+	}
+	else if (SCHEDULING_POLICY == "par_bs")
+	{
+		schedulingPolicy = ParBS;
+		if (DEBUG_INI_READER) 
+		{
+			DEBUG("SCHEDULING: PAR-BS");
+		}
+	}
 	else
 	{
-		cout << "WARNING: Unknown scheduling policy '"<<SCHEDULING_POLICY<<"'; valid options are 'rank_then_bank_round_robin' or 'bank_then_rank_round_robin'; defaulting to Bank Then Rank Round Robin" << endl;
+		cout << "WARNING: Unknown scheduling policy '"<<SCHEDULING_POLICY<<"'; valid options are 'rank_then_bank_round_robin', 'bank_then_rank_round_robin', 'fr_fcfs', 'atlas', 'bliss' or 'par_bs'; defaulting to Bank Then Rank Round Robin" << endl;
 		schedulingPolicy = BankThenRankRoundRobin;
 	}
 
@@ -36,6 +36,7 @@
 #include <sstream>
 #include <string>
 #include <map> 
+#include <vector>
 #include "SystemConfiguration.h"
 
 using namespace std;
@@ -95,11 +96,29 @@ public:
   unsigned tCKE;
   unsigned tXP;
   unsigned tCMD;
+  //the tRP after a WRITE_P is the array write, done in WRITE_ITERATIONS
+  //program-and-verify steps; with WRITE_PAUSING a read waiting for the bank
+  //gets in between two steps, and a read that has waited
+  //WRITE_CANCEL_THRESHOLD cycles (0 for never) aborts the write, which is
+  //queued again behind it
+  unsigned WRITE_ITERATIONS;
+  bool WRITE_PAUSING;
+  unsigned WRITE_CANCEL_THRESHOLD;
+  //with tSET set, the array write of a WRITE_P is instead a tRESET pulse
+  //followed by SET-and-verify iterations of tSET each, the number of which
+  //WRITE_ITERATION_DISTRIBUTION weighs from 1 to WRITE_ITERATIONS (always
+  //WRITE_ITERATIONS if empty)
+  unsigned tSET;
+  unsigned tRESET;
+  string WRITE_ITERATION_DISTRIBUTION;
 
   float ArrayReadEnergy;
   float ArrayWriteEnergy;
   float RowBufferReadEnergy;
   float RowBufferWriteEnergy;
+  //per bit and pulse, in place of ArrayWriteEnergy when tSET is set
+  float SetEnergy;
+  float ResetEnergy;
 
 
   unsigned IDD0;
@@ -118,11 +137,19 @@ public:
   unsigned IDD7;
   float Vdd;
   
+  //channels of this memory type, each with a memory controller and an
+  //IniReader of its own; addresses are interleaved across them
+  unsigned NUM_CHANS;
   //in bytes
   unsigned JEDEC_DATA_BUS_BITS;
   //Memory Controller related parameters
   unsigned TRANS_QUEUE_DEPTH;
   unsigned CMD_QUEUE_DEPTH;
+  //writes wait in a queue of their own when WRITE_QUEUE_DEPTH isn't 0, and
+  //are drained from the high watermark down to the low one
+  unsigned WRITE_QUEUE_DEPTH;
+  unsigned WRITE_HIGH_WATERMARK;
+  unsigned WRITE_LOW_WATERMARK;
   //cycles within an epoch
   unsigned EPOCH_LENGTH;
   //Power
@@ -143,9 +170,13 @@ public:
   SchedulingPolicy schedulingPolicy;
   AddressMappingScheme addressMappingScheme;
   QueuingStructure queuingStructure;
+  //odds of a write needing at most 1, 2, ... iterations, from
+  //WRITE_ITERATION_DISTRIBUTION, and the fewest it may need
+  vector<double> writeIterationOdds;
+  unsigned minWriteIterations;
 
   //Map the string names to the variables they set
-  ConfigMap configMap[64]; 
+  ConfigMap configMap[75]; 
 
 	typedef std::map<string, string> OverrideMap;
 	typedef OverrideMap::const_iterator OverrideIterator; 
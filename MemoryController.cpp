@@ -39,6 +39,8 @@
 #include "MemorySystem.h"
 #include "AddressMapping.h"
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 
 #define SEQUENTIAL(rank,bank) (rank*iniReader->NUM_BANKS)+bank
 
@@ -51,16 +53,18 @@ uint64_t totalEpochLatency_MS = 0;
 uint64_t totalReads_MS = 0;
 uint64_t totalWrites_MS = 0;
 
-uint64_t actpreNum = 0;
-uint64_t burstNum = 0;
-uint64_t refreshNum = 0;
+//summed over all channels, which may be updated by threads of their own
+std::atomic<uint64_t> actpreNum(0);
+std::atomic<uint64_t> burstNum(0);
+std::atomic<uint64_t> refreshNum(0);
 
-uint64_t actpreNum_dram = 0;
-uint64_t burstNum_dram = 0;
-uint64_t refreshNum_dram = 0;
-uint64_t actpreNum_pcm = 0;
-uint64_t burstNum_pcm = 0;
-uint64_t refreshNum_pcm = 0;
+//per memory type, summed over all channels of the type
+std::atomic<uint64_t> actpreNum_dram(0);
+std::atomic<uint64_t> burstNum_dram(0);
+std::atomic<uint64_t> refreshNum_dram(0);
+std::atomic<uint64_t> actpreNum_pcm(0);
+std::atomic<uint64_t> burstNum_pcm(0);
+std::atomic<uint64_t> refreshNum_pcm(0);
 
 
 
@@ -69,13 +73,13 @@ double totalActpreEnergy_MS = 0.0;
 double totalBurstEnergy_MS = 0.0;
 double totalRefreshEnergy_MS = 0.0;
 
-uint64_t dram_read=0;
-uint64_t dram_write=0;
-uint64_t pcm_read=0;
-uint64_t pcm_write=0;
+std::atomic<uint64_t> dram_read(0);
+std::atomic<uint64_t> dram_write(0);
+std::atomic<uint64_t> pcm_read(0);
+std::atomic<uint64_t> pcm_write(0);
 
-uint64_t rowBufferHitCount_dram = 0;
-uint64_t rowBufferHitCount_pcm = 0;
+std::atomic<uint64_t> rowBufferHitCount_dram(0);
+std::atomic<uint64_t> rowBufferHitCount_pcm(0);
 
 double totalReadsBandwidth_MS=0.0;
 double totalWritesBandwidth_MS=0.0;
@@ -83,6 +87,15 @@ vector<unsigned> readLatency;
 vector<unsigned> writeLatency;
 vector<unsigned> transactionQueueDelay;
 vector<unsigned> commandQueueDelay;
+//the lists above are only summed up or sorted at the end, so channels that are
+//  updated by threads of their own just have to take turns adding to them
+std::mutex latencyListsLock;
+
+static void recordLatency(vector<unsigned> &list, unsigned latency)
+{
+	std::lock_guard<std::mutex> lock(latencyListsLock);
+	list.push_back(latency);
+}
 
 
 //ofstream ofs_dram("epoch_dram.txt");
@@ -92,14 +105,25 @@ vector<unsigned> commandQueueDelay;
 using namespace DRAMSim;
 
 MemoryController::MemoryController(MemorySystem *parent, CSVWriter &csvOut_, ostream &dramsim_log_) :
-    allIniReaders(parent->allIniReaders),
+		transactionQueue(parent->iniReader->NUM_RANKS, parent->iniReader->NUM_BANKS, parent->iniReader->TRANS_QUEUE_DEPTH),
+		writeQueue(parent->iniReader->NUM_RANKS, parent->iniReader->NUM_BANKS, max(parent->iniReader->WRITE_QUEUE_DEPTH, 1U)),
+		addressMapping(parent->addressMapping),
     iniReader(parent->iniReader),
 		dramsim_log(dramsim_log_),
-		bankStates(parent->iniReader->NUM_RANKS, vector<BankState>(parent->iniReader->NUM_BANKS, dramsim_log)),
-		commandQueue(bankStates, dramsim_log_,parent->iniReader),
+		bankStates(parent->bankStates),
+		timingWheel(parent->timingWheel),
+		busPacketPool(parent->busPacketPool),
+		transactionPool(parent->transactionPool),
+		commandQueue(bankStates, dramsim_log_,parent->iniReader,parent->timingWheel,parent->busPacketPool),
 		poppedBusPacket(NULL),
+		transactionQueueStalled(false),
+		lineBitWidth(dramsim_log2((parent->iniReader->JEDEC_DATA_BUS_BITS/8)*parent->iniReader->BL)),
+		drainingWrites(false),
+		lastColumnWasWrite(false),
+		columnIssued(false),
 		csvOut(csvOut_),
 		totalTransactions(0),
+		nextTransactionID(1),
 		refreshRank(0)
 {
 	//get handle on parent
@@ -112,11 +136,23 @@ MemoryController::MemoryController(MemorySystem *parent, CSVWriter &csvOut_, ost
 	dataCyclesLeft = 0;
 	cmdCyclesLeft = 0;
 
+	readToWriteTurnarounds = 0;
+	writeToReadTurnarounds = 0;
+	writeDrains = 0;
+	writesMerged = 0;
+	readsForwarded = 0;
+	writesPaused = 0;
+	writesCancelled = 0;
+	arrayWrites = 0;
+	totalWriteIterations = 0;
+	//every channel draws the iterations of its writes from a sequence of its own
+	seed_seq seeds = {(uint64_t)iniReader->SystemType, (uint64_t)parent->systemID};
+	random.seed(seeds);
+
 	//set here to avoid compile errors
 	currentClockCycle = 0;
 
 	//reserve memory for vectors
-	transactionQueue.reserve(iniReader->TRANS_QUEUE_DEPTH);
 	powerDown = vector<bool>(iniReader->NUM_RANKS,false);
 	grandTotalBankAccesses = vector<uint64_t>(iniReader->NUM_RANKS*iniReader->NUM_BANKS,0);
 	totalReadsPerBank = vector<uint64_t>(iniReader->NUM_RANKS*iniReader->NUM_BANKS,0);
@@ -125,12 +161,21 @@ MemoryController::MemoryController(MemorySystem *parent, CSVWriter &csvOut_, ost
 	totalWritesPerRank = vector<uint64_t>(iniReader->NUM_RANKS,0);
 	totalReadsPerRank_Receive = vector<uint64_t>(iniReader->NUM_RANKS,0);
 	totalWritesPerRank_Receive = vector<uint64_t>(iniReader->NUM_RANKS,0);
-
-	writeDataCountdown.reserve(iniReader->NUM_RANKS);
+	arrayWriteStart = vector<uint64_t>(iniReader->NUM_RANKS*iniReader->NUM_BANKS,0);
+	arrayWriteEnd = vector<uint64_t>(iniReader->NUM_RANKS*iniReader->NUM_BANKS,0);
+	pausedArrayWrite = vector<unsigned>(iniReader->NUM_RANKS*iniReader->NUM_BANKS,0);
+	writeLength = vector<unsigned>(iniReader->NUM_RANKS*iniReader->NUM_BANKS,0);
+	pausedWriteLength = vector<unsigned>(iniReader->NUM_RANKS*iniReader->NUM_BANKS,0);
+	writingPacket = vector<BusPacket *>(iniReader->NUM_RANKS*iniReader->NUM_BANKS,NULL);
+	pausedPacket = vector<BusPacket *>(iniReader->NUM_RANKS*iniReader->NUM_BANKS,NULL);
+	lastActivate = vector<uint64_t>(iniReader->NUM_RANKS,0);
+
+	writeDataReady.reserve(iniReader->NUM_RANKS);
 	writeDataToSend.reserve(iniReader->NUM_RANKS);
+	returnTransaction.reserve(iniReader->TRANS_QUEUE_DEPTH);
   if(iniReader->SystemType==TYPE_DRAM) {
     refreshRank=0;// just put it here, though it's been done on the init list
-	  refreshCountdown.reserve(iniReader->NUM_RANKS);
+	  nextRefresh.reserve(iniReader->NUM_RANKS);
   }else if(iniReader->SystemType==TYPE_NVM) {
     refreshRank=-1;
   }else {
@@ -147,11 +192,14 @@ MemoryController::MemoryController(MemorySystem *parent, CSVWriter &csvOut_, ost
 
 	totalEpochLatency = vector<uint64_t> (iniReader->NUM_RANKS*iniReader->NUM_BANKS,0);
 	totalEpochLatency_Write = vector<uint64_t> (iniReader->NUM_RANKS*iniReader->NUM_BANKS,0);
+	totalReadsPerSource = vector<uint64_t>(1U<<BUSPACKET_SOURCE_BITS,0);
+	totalWritesPerSource = vector<uint64_t>(1U<<BUSPACKET_SOURCE_BITS,0);
+	totalReadLatencyPerSource = vector<uint64_t>(1U<<BUSPACKET_SOURCE_BITS,0);
 
 	//staggers when each rank is due for a refresh
 	for (size_t i=0;i<iniReader->NUM_RANKS;i++)
 	{
-		refreshCountdown.push_back((int)((iniReader->REFRESH_PERIOD/iniReader->tCK)/iniReader->NUM_RANKS)*(i+1));
+		nextRefresh.push_back((unsigned)((int)((iniReader->REFRESH_PERIOD/iniReader->tCK)/iniReader->NUM_RANKS)*(i+1)));
 	}
 }
 
@@ -161,22 +209,24 @@ void MemoryController::receiveFromBus(BusPacket *bpacket)
 	if (bpacket->busPacketType != DATA)
 	{
 		ERROR("== Error - Memory Controller received a non-DATA bus packet from rank");
-		bpacket->print();
+		bpacket->print(dramsim_log);
 		exit(0);
 	}
 
 	if (DEBUG_BUS)
 	{
 		PRINTN(" -- MC Receiving From Data Bus : ");
-		bpacket->print();
+		bpacket->print(dramsim_log);
 	}
 
 	//add to return read data queue
-	returnTransaction.push_back(new Transaction(RETURN_DATA, bpacket->physicalAddress, bpacket->data));
+	Transaction *returned = new (transactionPool.allocate()) Transaction(RETURN_DATA, bpacket->physicalAddress, bpacket->getData());
+	returned->id = bpacket->transactionID;
+	returnTransaction.push_back(returned);
 	totalReadsPerBank[SEQUENTIAL(bpacket->rank,bpacket->bank)]++;
 
 	// this delete statement saves a mindboggling amount of memory
-	delete(bpacket);
+	busPacketPool.release(bpacket);
 }
 
 //sends read data back to the CPU
@@ -200,44 +250,18 @@ void MemoryController::update()
 
 	//PRINT(" ------------------------- [" << currentClockCycle << "] -------------------------");
 
-	//update bank states
-	for (size_t i=0;i<iniReader->NUM_RANKS;i++)
+	//update bank states and tFAW windows whose deadline has come
+	dueEvents.clear();
+	timingWheel.expire(currentClockCycle, dueEvents);
+	for (size_t i=0;i<dueEvents.size();i++)
 	{
-		for (size_t j=0;j<iniReader->NUM_BANKS;j++)
+		if (dueEvents[i].type == BANK_STATE_CHANGE)
 		{
-			if (bankStates[i][j].stateChangeCountdown>0)
-			{
-				//decrement counters
-				bankStates[i][j].stateChangeCountdown--;
-
-				//if counter has reached 0, change state
-				if (bankStates[i][j].stateChangeCountdown == 0)
-				{
-					switch (bankStates[i][j].lastCommand)
-					{
-						//only these commands have an implicit state change
-					case WRITE_P:
-					case READ_P:
-						bankStates[i][j].currentBankState = Precharging;
-						bankStates[i][j].lastCommand = PRECHARGE;
-						bankStates[i][j].stateChangeCountdown = iniReader->tRP;
-						break;
-					case READ:
-						if(iniReader->SystemType == TYPE_NVM && iniReader->rowBufferPolicy == ClosePage)
-						{
-							bankStates[i][j].currentBankState = Idle;
-						}
-						break;
-
-					case REFRESH:
-					case PRECHARGE:
-						bankStates[i][j].currentBankState = Idle;
-						break;
-					default:
-						break;
-					}
-				}
-			}
+			changeBankState(dueEvents[i].rank, dueEvents[i].bank);
+		}
+		else
+		{
+			commandQueue.closeActivateWindow(dueEvents[i].rank);
 		}
 	}
 
@@ -259,8 +283,9 @@ void MemoryController::update()
 		dataCyclesLeft--;
 		if (dataCyclesLeft == 0)
 		{
-			//inform upper levels that a write is done
-			if (parentMemorySystem->WriteDataDone!=NULL)
+			//inform upper levels that a write is done; a cancelled write that
+			//  goes again belongs to no transaction and was reported already
+			if (parentMemorySystem->WriteDataDone!=NULL && outgoingDataPacket->transactionID != 0)
 			{
 				(*parentMemorySystem->WriteDataDone)(parentMemorySystem->systemID,outgoingDataPacket->physicalAddress, currentClockCycle);
 			}
@@ -279,20 +304,15 @@ void MemoryController::update()
 	//then send data on bus
 	//
 	//write data held in fifo vector along with countdowns
-	if (writeDataCountdown.size() > 0)
+	if (writeDataReady.size() > 0)
 	{
-		for (size_t i=0;i<writeDataCountdown.size();i++)
-		{
-			writeDataCountdown[i]--;
-		}
-
-		if (writeDataCountdown[0]==0)
+		if (writeDataReady.front()==currentClockCycle)
 		{
 			//send to bus and print debug stuff
 			if (DEBUG_BUS)
 			{
 				PRINTN(" -- MC Issuing On Data Bus    : ");
-				writeDataToSend[0]->print();
+				writeDataToSend.front()->print(dramsim_log);
 			}
 
 			// queue up the packet to be sent
@@ -302,26 +322,27 @@ void MemoryController::update()
 				exit(-1);
 			}
 
-			outgoingDataPacket = writeDataToSend[0];
+			outgoingDataPacket = writeDataToSend.front();
 			dataCyclesLeft = iniReader->BL/2;
 
-			for(size_t i=0; i<pendingWriteTransactions.size(); i++)
+			Transaction *write = pendingWriteTransactions.remove(outgoingDataPacket->transactionID);
+			if (write != NULL)
 			{
-				if(outgoingDataPacket->physicalAddress == pendingWriteTransactions[i]->address)
-				{
-					writeLatency.push_back(currentClockCycle - pendingWriteTransactions[i]->timeAdded);
-					totalEpochLatency_Write[SEQUENTIAL(outgoingDataPacket->rank,outgoingDataPacket->bank)] += currentClockCycle - pendingWriteTransactions[i]->timeAdded;
-					pendingWriteTransactions.erase(pendingWriteTransactions.begin()+i);
-					break;
-				}
+				recordLatency(writeLatency, currentClockCycle - write->timeAdded);
+				totalEpochLatency_Write[SEQUENTIAL(outgoingDataPacket->rank,outgoingDataPacket->bank)] += currentClockCycle - write->timeAdded;
+				transactionPool.release(write);
 			}
 			
 			
-			totalTransactions++;
-			totalWritesPerBank[SEQUENTIAL(writeDataToSend[0]->rank,writeDataToSend[0]->bank)]++;
+			if (outgoingDataPacket->transactionID != 0)
+			{
+				totalTransactions++;
+				totalWritesPerBank[SEQUENTIAL(outgoingDataPacket->rank,outgoingDataPacket->bank)]++;
+				totalWritesPerSource[outgoingDataPacket->source]++;
+			}
 
-			writeDataCountdown.erase(writeDataCountdown.begin());
-			writeDataToSend.erase(writeDataToSend.begin());
+			writeDataReady.pop_front();
+			writeDataToSend.pop_front();
 		}
 	}
 
@@ -329,11 +350,11 @@ void MemoryController::update()
   {
     //if its time for a refresh issue a refresh
     // else pop from command queue if it's not empty
-    if (refreshCountdown[refreshRank]==0)
+    if (nextRefresh[refreshRank]==currentClockCycle)
     {
       commandQueue.needRefresh(refreshRank);
       (*ranks)[refreshRank]->refreshWaiting = true;
-      refreshCountdown[refreshRank] =	 iniReader->REFRESH_PERIOD/iniReader->tCK;
+      nextRefresh[refreshRank] = currentClockCycle + (unsigned)(iniReader->REFRESH_PERIOD/iniReader->tCK);
       refreshRank++;
       //type conversion, possible risks may occur
       if (refreshRank ==(signed) iniReader->NUM_RANKS)
@@ -342,7 +363,7 @@ void MemoryController::update()
       }
     }
     //if a rank is powered down, make sure we power it up in time for a refresh
-    else if (powerDown[refreshRank] && refreshCountdown[refreshRank] <= iniReader->tXP)
+    else if (powerDown[refreshRank] && nextRefresh[refreshRank] <= currentClockCycle + iniReader->tXP)
     {
       (*ranks)[refreshRank]->refreshWaiting = true;
     }
@@ -356,19 +377,35 @@ void MemoryController::update()
 		if (poppedBusPacket->busPacketType == WRITE || poppedBusPacket->busPacketType == WRITE_P)
 		{
 
-			writeDataToSend.push_back(new BusPacket(DATA, poppedBusPacket->physicalAddress, poppedBusPacket->column,
+			writeDataToSend.push_back(new (busPacketPool.allocate()) BusPacket(DATA, poppedBusPacket->physicalAddress, poppedBusPacket->column,
 			                                    poppedBusPacket->row, poppedBusPacket->rank, poppedBusPacket->bank,
-			                                    poppedBusPacket->data, dramsim_log));
-			writeDataCountdown.push_back(iniReader->WL);
+			                                    poppedBusPacket->getData(), poppedBusPacket->transactionID, poppedBusPacket->source));
+			writeDataReady.push_back(currentClockCycle + iniReader->WL);
+
+			Transaction *write = pendingWriteTransactions.find(poppedBusPacket->transactionID);
+			if (write != NULL)
+			{
+				recordLatency(commandQueueDelay, currentClockCycle-write->timeAdded);
+			}
+		}
 
-			for(size_t i=0; i<pendingWriteTransactions.size(); i++)
+		if (poppedBusPacket->busPacketType == READ || poppedBusPacket->busPacketType == READ_P ||
+		        poppedBusPacket->busPacketType == WRITE || poppedBusPacket->busPacketType == WRITE_P)
+		{
+			bool isWrite = poppedBusPacket->busPacketType == WRITE || poppedBusPacket->busPacketType == WRITE_P;
+			if (columnIssued && isWrite != lastColumnWasWrite)
 			{
-				if(pendingWriteTransactions[i]->address == poppedBusPacket->physicalAddress)
+				if (isWrite)
 				{
-					commandQueueDelay.push_back(currentClockCycle-pendingWriteTransactions[i]->timeAdded);
+					readToWriteTurnarounds++;
+				}
+				else
+				{
+					writeToReadTurnarounds++;
 				}
-					
 			}
+			columnIssued = true;
+			lastColumnWasWrite = isWrite;
 		}
 
 		//
@@ -407,7 +444,7 @@ void MemoryController::update()
 					bankStates[rank][bank].nextActivate = max(currentClockCycle + READ_AUTOPRE_DELAY,
 							bankStates[rank][bank].nextActivate);
 					bankStates[rank][bank].lastCommand = READ_P;
-					bankStates[rank][bank].stateChangeCountdown = READ_TO_PRE_DELAY;
+					scheduleStateChange(rank, bank, READ_TO_PRE_DELAY);
 
 					actpreEnergy[rank] += iniReader->ArrayWriteEnergy * iniReader->NUM_COLS * iniReader->JEDEC_DATA_BUS_BITS;
 					actpreNum++;				
@@ -427,7 +464,7 @@ void MemoryController::update()
 					if(iniReader->SystemType == TYPE_NVM && iniReader->rowBufferPolicy == ClosePage)
 					{
 						bankStates[rank][bank].nextActivate = iniReader->AL+iniReader->tRTP;
-						bankStates[rank][bank].stateChangeCountdown = iniReader->AL+iniReader->BL/2;
+						scheduleStateChange(rank, bank, iniReader->AL+iniReader->BL/2);
 					}
 					else
 					{
@@ -440,36 +477,17 @@ void MemoryController::update()
 
 				}
 
-				for (size_t i=0;i<iniReader->NUM_RANKS;i++)
-				{
-					for (size_t j=0;j<iniReader->NUM_BANKS;j++)
-					{
-						if (i!=poppedBusPacket->rank)
-						{
-							//check to make sure it is active before trying to set (save's time?)
-							if (bankStates[i][j].currentBankState == RowActive)
-							{
-								bankStates[i][j].nextRead = max(currentClockCycle + iniReader->BL/2 + iniReader->tRTRS, bankStates[i][j].nextRead);
-								bankStates[i][j].nextWrite = max(currentClockCycle + READ_TO_WRITE_DELAY,
-										bankStates[i][j].nextWrite);
-							}
-						}
-						else
-						{
-							bankStates[i][j].nextRead = max(currentClockCycle + max(iniReader->tCCD, iniReader->BL/2), bankStates[i][j].nextRead);
-							bankStates[i][j].nextWrite = max(currentClockCycle + READ_TO_WRITE_DELAY,
-									bankStates[i][j].nextWrite);
-						}
-					}
-				}
+				//the other ranks only hold off their banks with an open row
+				bankStates.issueColumnAccess(rank, BankStateTable::ColumnRead, currentClockCycle,
+						currentClockCycle + max(iniReader->tCCD, iniReader->BL/2), currentClockCycle + READ_TO_WRITE_DELAY,
+						currentClockCycle + iniReader->BL/2 + iniReader->tRTRS, currentClockCycle + READ_TO_WRITE_DELAY);
 
 				if (poppedBusPacket->busPacketType == READ_P)
 				{
 					//set read and write to nextActivate so the state table will prevent a read or write
 					//  being issued (in cq.isIssuable())before the bank state has been changed because of the
 					//  auto-precharge associated with this command
-					bankStates[rank][bank].nextRead = bankStates[rank][bank].nextActivate;
-					bankStates[rank][bank].nextWrite = bankStates[rank][bank].nextActivate;
+					bankStates.setColumnAccesses(rank, bank, currentClockCycle, bankStates[rank][bank].nextActivate);
 				}
 				
 
@@ -478,12 +496,30 @@ void MemoryController::update()
 			case WRITE:
 				if (poppedBusPacket->busPacketType == WRITE_P) 
 				{
-					bankStates[rank][bank].nextActivate = max(currentClockCycle + WRITE_AUTOPRE_DELAY,
+					unsigned iterations = drawWriteIterations();
+					writeLength[SEQUENTIAL(rank,bank)] = ARRAY_WRITE_TIME(iterations);
+					arrayWrites++;
+					totalWriteIterations += iterations;
+					bankStates[rank][bank].nextActivate = max(currentClockCycle + WRITE_TO_PRE_DELAY + writeLength[SEQUENTIAL(rank,bank)],
 							bankStates[rank][bank].nextActivate);
 					bankStates[rank][bank].lastCommand = WRITE_P;
-					bankStates[rank][bank].stateChangeCountdown = WRITE_TO_PRE_DELAY;
+					scheduleStateChange(rank, bank, WRITE_TO_PRE_DELAY);
+					if (WRITES_INTERRUPTIBLE && iniReader->WRITE_CANCEL_THRESHOLD > 0)
+					{
+						//the copy goes again if the write is cancelled, by then the
+						//  write has been reported done
+						writingPacket[SEQUENTIAL(rank,bank)] = new (busPacketPool.allocate()) BusPacket(*poppedBusPacket);
+						writingPacket[SEQUENTIAL(rank,bank)]->transactionID = 0;
+					}
 
-					actpreEnergy[rank] += iniReader->ArrayWriteEnergy * iniReader->NUM_COLS * iniReader->JEDEC_DATA_BUS_BITS;
+					if (iniReader->tSET > 0)
+					{
+						actpreEnergy[rank] += (iniReader->ResetEnergy + iterations * iniReader->SetEnergy) * iniReader->NUM_COLS * iniReader->JEDEC_DATA_BUS_BITS;
+					}
+					else
+					{
+						actpreEnergy[rank] += iniReader->ArrayWriteEnergy * iniReader->NUM_COLS * iniReader->JEDEC_DATA_BUS_BITS;
+					}
 					actpreNum++;
 					
 					 if(iniReader->SystemType==TYPE_DRAM)
@@ -522,35 +558,16 @@ void MemoryController::update()
 				 }
 				 
 
-				for (size_t i=0;i<iniReader->NUM_RANKS;i++)
-				{
-					for (size_t j=0;j<iniReader->NUM_BANKS;j++)
-					{
-						if (i!=poppedBusPacket->rank)
-						{
-							if (bankStates[i][j].currentBankState == RowActive)
-							{
-								bankStates[i][j].nextWrite = max(currentClockCycle + iniReader->BL/2 + iniReader->tRTRS, bankStates[i][j].nextWrite);
-								bankStates[i][j].nextRead = max(currentClockCycle + WRITE_TO_READ_DELAY_R,
-										bankStates[i][j].nextRead);
-							}
-						}
-						else
-						{
-							bankStates[i][j].nextWrite = max(currentClockCycle + max(iniReader->BL/2, iniReader->tCCD), bankStates[i][j].nextWrite);
-							bankStates[i][j].nextRead = max(currentClockCycle + WRITE_TO_READ_DELAY_B,
-									bankStates[i][j].nextRead);
-						}
-					}
-				}
+				bankStates.issueColumnAccess(rank, BankStateTable::ColumnWrite, currentClockCycle,
+						currentClockCycle + WRITE_TO_READ_DELAY_B, currentClockCycle + max(iniReader->BL/2, iniReader->tCCD),
+						currentClockCycle + WRITE_TO_READ_DELAY_R, currentClockCycle + iniReader->BL/2 + iniReader->tRTRS);
 
 				//set read and write to nextActivate so the state table will prevent a read or write
 				//  being issued (in cq.isIssuable())before the bank state has been changed because of the
 				//  auto-precharge associated with this command
 				if (poppedBusPacket->busPacketType == WRITE_P)
 				{
-					bankStates[rank][bank].nextRead = bankStates[rank][bank].nextActivate;
-					bankStates[rank][bank].nextWrite = bankStates[rank][bank].nextActivate;
+					bankStates.setColumnAccesses(rank, bank, currentClockCycle, bankStates[rank][bank].nextActivate);
 				}
 
 				break;
@@ -575,6 +592,7 @@ void MemoryController::update()
 
 				
 				bankStates[rank][bank].currentBankState = RowActive;
+				bankStates.openRow(rank, bank, currentClockCycle);
 				bankStates[rank][bank].lastCommand = ACTIVATE;
 				bankStates[rank][bank].openRowAddress = poppedBusPacket->row;
 				bankStates[rank][bank].nextActivate = max(currentClockCycle + iniReader->tRC, bankStates[rank][bank].nextActivate);
@@ -585,19 +603,15 @@ void MemoryController::update()
 				bankStates[rank][bank].nextRead = max(currentClockCycle + (iniReader->tRCD-iniReader->AL), bankStates[rank][bank].nextRead);
 				bankStates[rank][bank].nextWrite = max(currentClockCycle + (iniReader->tRCD-iniReader->AL), bankStates[rank][bank].nextWrite);
 
-				for (size_t i=0;i<iniReader->NUM_BANKS;i++)
-				{
-					if (i!=poppedBusPacket->bank)
-					{
-						bankStates[rank][i].nextActivate = max(currentClockCycle + iniReader->tRRD, bankStates[rank][i].nextActivate);
-					}
-				}
+				bankStates.delayActivates(rank, bank, currentClockCycle + iniReader->tRRD);
+				lastActivate[rank] = currentClockCycle;
 
 				break;
 			case PRECHARGE:
 				bankStates[rank][bank].currentBankState = Precharging;
+				bankStates.closeRow(rank, bank);
 				bankStates[rank][bank].lastCommand = PRECHARGE;
-				bankStates[rank][bank].stateChangeCountdown = iniReader->tRP;
+				scheduleStateChange(rank, bank, iniReader->tRP);
 				bankStates[rank][bank].nextActivate = max(currentClockCycle + iniReader->tRP, bankStates[rank][bank].nextActivate);
 
 				actpreEnergy[rank] += iniReader->ArrayWriteEnergy * iniReader->NUM_COLS * iniReader->JEDEC_DATA_BUS_BITS;
@@ -637,7 +651,7 @@ void MemoryController::update()
 					bankStates[rank][i].nextActivate = currentClockCycle + iniReader->tRFC;
 					bankStates[rank][i].currentBankState = Refreshing;
 					bankStates[rank][i].lastCommand = REFRESH;
-					bankStates[rank][i].stateChangeCountdown = iniReader->tRFC;
+					scheduleStateChange(rank, i, iniReader->tRFC);
 				}
 
 				break;
@@ -650,7 +664,7 @@ void MemoryController::update()
 		if (DEBUG_BUS)
 		{
 			PRINTN(" -- MC Issuing On Command Bus : ");
-			poppedBusPacket->print();
+			poppedBusPacket->print(dramsim_log);
 		}
 
 		//check for collision on bus
@@ -664,101 +678,89 @@ void MemoryController::update()
 
 	}
 
-	for (size_t i=0;i<transactionQueue.size();i++)
+	//take a transaction whose bank has room in the command queue for its two
+	//	commands, and break it up into those commands
+	Transaction *transaction = popTransaction();
+	transactionQueueStalled = (transaction == NULL);
+	if (transaction != NULL)
 	{
-		//pop off top transaction from queue
-		//
-		//	assuming simple scheduling at the moment
-		//	will eventually add policies here
-		Transaction *transaction = transactionQueue[i];
-
-		//map address to rank,bank,row,col
-		unsigned newTransactionChan, newTransactionRank, newTransactionBank, newTransactionRow, newTransactionColumn;
+		//rank,bank,row,col were mapped when the transaction was added
+		unsigned newTransactionRank = transaction->rank;
+		unsigned newTransactionBank = transaction->bank;
+		unsigned newTransactionRow = transaction->row;
+		unsigned newTransactionColumn = transaction->column;
 
-		// pass these in as references so they get set by the addressMapping function
-		addressMapping(transaction->address, newTransactionChan, newTransactionRank, newTransactionBank, newTransactionRow, newTransactionColumn,allIniReaders);
-
-		//if we have room, break up the transaction into the appropriate commands
-		//and add them to the command queue
-		if (commandQueue.hasRoomFor(2, newTransactionRank, newTransactionBank))
+		if (transaction->transactionType == DATA_READ) 
 		{
-
+			totalReadsPerRank_Receive[newTransactionRank]++;
+		}
+		else
+		{
+			totalWritesPerRank_Receive[newTransactionRank]++;
+		}
+		if (DEBUG_ADDR_MAP) 
+		{
+			PRINTN("== New Transaction - Mapping Address [0x" << hex << transaction->address << dec << "]");
 			if (transaction->transactionType == DATA_READ) 
 			{
-				totalReadsPerRank_Receive[newTransactionRank]++;
+				PRINT(" (Read)");
 			}
 			else
 			{
-				totalWritesPerRank_Receive[newTransactionRank]++;
-			}
-			if (DEBUG_ADDR_MAP) 
-			{
-				PRINTN("== New Transaction - Mapping Address [0x" << hex << transaction->address << dec << "]");
-				if (transaction->transactionType == DATA_READ) 
-				{
-					PRINT(" (Read)");
-				}
-				else
-				{
-					PRINT(" (Write)");
-				}
-				PRINT("  Rank : " << newTransactionRank);
-				PRINT("  Bank : " << newTransactionBank);
-				PRINT("  Row  : " << newTransactionRow);
-				PRINT("  Col  : " << newTransactionColumn);
+				PRINT(" (Write)");
 			}
+			PRINT("  Rank : " << newTransactionRank);
+			PRINT("  Bank : " << newTransactionBank);
+			PRINT("  Row  : " << newTransactionRow);
+			PRINT("  Col  : " << newTransactionColumn);
+		}
 
-			
-			
-
-			//now that we know there is room in the command queue, we can remove from the transaction queue
-			transactionQueue.erase(transactionQueue.begin()+i);
+		
 
-			//create activate command to the row we just translated
-			BusPacket *ACTcommand = new BusPacket(ACTIVATE, transaction->address,
-					newTransactionColumn, newTransactionRow, newTransactionRank,
-					newTransactionBank, 0, dramsim_log);
+		//create activate command to the row we just translated
+		BusPacket *ACTcommand = new (busPacketPool.allocate()) BusPacket(ACTIVATE, transaction->address,
+				newTransactionColumn, newTransactionRow, newTransactionRank,
+				newTransactionBank, 0, transaction->id, transaction->source);
 
-			//create read or write command and enqueue it
-			BusPacketType bpType = transaction->getBusPacketType(parentMemorySystem->systemID,iniReader);
-			BusPacket *command = new BusPacket(bpType, transaction->address,
-					newTransactionColumn, newTransactionRow, newTransactionRank,
-					newTransactionBank, transaction->data, dramsim_log);
-			
+		//create read or write command and enqueue it
+		BusPacketType bpType = transaction->getBusPacketType(parentMemorySystem->systemID,iniReader);
+		BusPacket *command = new (busPacketPool.allocate()) BusPacket(bpType, transaction->address,
+				newTransactionColumn, newTransactionRow, newTransactionRank,
+				newTransactionBank, transaction->getData(), transaction->id, transaction->source);
+		
 
 
-			commandQueue.enqueue(ACTcommand);
-			commandQueue.enqueue(command);
+		commandQueue.enqueue(ACTcommand);
+		commandQueue.enqueue(command);
 
-			// If we have a read, save the transaction so when the data comes back
-			// in a bus packet, we can staple it back into a transaction and return it
-			if (transaction->transactionType == DATA_READ)
-			{
-				pendingReadTransactions.push_back(transaction);
-			}
-			else if(transaction->transactionType == DATA_WRITE)
-			{
-				
-				transactionQueueDelay.push_back(currentClockCycle-transaction->timeAdded);
-				//transaction->timeAdded = currentClockCycle;
-				pendingWriteTransactions.push_back(transaction);
-			}
-			else
+		// If we have a read, save the transaction so when the data comes back
+		// in a bus packet, we can staple it back into a transaction and return it
+		if (transaction->transactionType == DATA_READ)
+		{
+			pendingReadTransactions.insert(transaction);
+			//a read for a bank in the middle of an array write may pause or cancel it
+			if (arrayWriteEnd[SEQUENTIAL(newTransactionRank,newTransactionBank)] != 0)
 			{
-				// just delete the transaction now that it's a buspacket
-				delete transaction; 
+				scheduleArrayWriteCheck(newTransactionRank, newTransactionBank);
 			}
-			/* only allow one transaction to be scheduled per cycle -- this should
-			 * be a reasonable assumption considering how much logic would be
-			 * required to schedule multiple entries per cycle (parallel data
-			 * lines, switching logic, decision logic)
-			 */
-			break;
 		}
-		else // no room, do nothing this cycle
+		else if(transaction->transactionType == DATA_WRITE)
+		{
+			
+			recordLatency(transactionQueueDelay, currentClockCycle-transaction->timeAdded);
+			//transaction->timeAdded = currentClockCycle;
+			pendingWriteTransactions.insert(transaction);
+		}
+		else
 		{
-			//PRINT( "== Warning - No room in command queue" << endl;
+			// just delete the transaction now that it's a buspacket
+			transactionPool.release(transaction); 
 		}
+		/* only allow one transaction to be scheduled per cycle -- this should
+		 * be a reasonable assumption considering how much logic would be
+		 * required to schedule multiple entries per cycle (parallel data
+		 * lines, switching logic, decision logic)
+		 */
 	}
 
 
@@ -855,55 +857,27 @@ void MemoryController::update()
 	{
 		if (DEBUG_BUS)
 		{
-			PRINTN(" -- MC Issuing to CPU bus : " << *returnTransaction[0]);
+			PRINTN(" -- MC Issuing to CPU bus : " << *returnTransaction.front());
 		}
 		totalTransactions++;
 
-		bool foundMatch=false;
 		//find the pending read transaction to calculate latency
-		for (size_t i=0;i<pendingReadTransactions.size();i++)
+		Transaction *read = pendingReadTransactions.remove(returnTransaction.front()->id);
+		if (read == NULL)
 		{
-			if (pendingReadTransactions[i]->address == returnTransaction[0]->address)
-			{
-				//if(currentClockCycle - pendingReadTransactions[i]->timeAdded > 2000)
-				//	{
-				//		pendingReadTransactions[i]->print();
-				//		exit(0);
-				//	}
-				unsigned chan,rank,bank,row,col;
-				addressMapping(returnTransaction[0]->address,chan,rank,bank,row,col,allIniReaders);
-				insertHistogram(currentClockCycle-pendingReadTransactions[i]->timeAdded,rank,bank);
-				/*
-				if(iniReader->SystemType == TYPE_DRAM)
-				{
-					ofs_dram<<"currentClockCycle: "<<currentClockCycle<<"; "<<currentClockCycle-pendingReadTransactions[i]->timeAdded<<endl;
-				}else{
-						ofs_pcm<<"currentClockCycle: "<<currentClockCycle<<"; "<<currentClockCycle-pendingReadTransactions[i]->timeAdded<<endl;
-					}
-				*/
-				
-				//return latency
-				returnReadData(pendingReadTransactions[i]);
-
-				delete pendingReadTransactions[i];
-				pendingReadTransactions.erase(pendingReadTransactions.begin()+i);
-				foundMatch=true; 
-				break;
-			}
-		}
-		if (!foundMatch)
-		{
-			ERROR("Can't find a matching transaction for 0x"<<hex<<returnTransaction[0]->address<<dec);
+			ERROR("Can't find a matching transaction for 0x"<<hex<<returnTransaction.front()->address<<dec);
 			abort(); 
 		}
-		delete returnTransaction[0];
-		returnTransaction.erase(returnTransaction.begin());
-	}
+		insertHistogram(currentClockCycle-read->timeAdded,read->rank,read->bank);
+		totalReadsPerSource[read->source]++;
+		totalReadLatencyPerSource[read->source] += currentClockCycle-read->timeAdded;
 
-	//decrement refresh counters
-	for (size_t i=0;i<iniReader->NUM_RANKS;i++)
-	{
-		refreshCountdown[i]--;
+		//return latency
+		returnReadData(read);
+
+		transactionPool.release(read);
+		transactionPool.release(returnTransaction.front());
+		returnTransaction.pop_front();
 	}
 
 	//
@@ -912,9 +886,19 @@ void MemoryController::update()
 	if (DEBUG_TRANS_Q)
 	{
 		PRINT("== Printing transaction queue");
-		for (size_t i=0;i<transactionQueue.size();i++)
+		size_t i=0;
+		for (TransactionQueue::Handle h=transactionQueue.begin();h!=transactionQueue.end();h=transactionQueue.next(h))
 		{
-			PRINTN("  " << i << "] "<< *transactionQueue[i]);
+			PRINTN("  " << i++ << "] "<< *transactionQueue[h]);
+		}
+		if (iniReader->WRITE_QUEUE_DEPTH > 0)
+		{
+			PRINT("== Printing write queue" << (drainingWrites ? " (draining)" : ""));
+			i=0;
+			for (TransactionQueue::Handle h=writeQueue.begin();h!=writeQueue.end();h=writeQueue.next(h))
+			{
+				PRINTN("  " << i++ << "] "<< *writeQueue[h]);
+			}
 		}
 	}
 
@@ -960,18 +944,404 @@ void MemoryController::update()
 
 }
 
+//the implicit state change of a command takes place delay cycles from now; this
+//  replaces any change the bank was still waiting for
+void MemoryController::scheduleStateChange(unsigned rank, unsigned bank, unsigned delay)
+{
+	bankStates[rank][bank].nextStateChange = currentClockCycle + delay;
+	timingWheel.schedule(currentClockCycle + delay, BANK_STATE_CHANGE, rank, bank);
+}
+
+//a bank state change has come due
+void MemoryController::changeBankState(unsigned rank, unsigned bank)
+{
+	BankState bankState = bankStates[rank][bank];
+	//the event is stale if the deadline has since been moved
+	if (bankState.nextStateChange != currentClockCycle)
+	{
+		return;
+	}
+	bankState.nextStateChange = 0;
+
+	switch (bankState.lastCommand)
+	{
+		//only these commands have an implicit state change
+	case WRITE_P:
+	case READ_P:
+		bankState.currentBankState = Precharging;
+		bankStates.closeRow(rank, bank);
+		if (bankState.lastCommand == WRITE_P)
+		{
+			bankState.lastCommand = PRECHARGE;
+			if (WRITES_INTERRUPTIBLE)
+			{
+				startArrayWrite(rank, bank, writeLength[SEQUENTIAL(rank,bank)], 0);
+			}
+			else
+			{
+				scheduleStateChange(rank, bank, writeLength[SEQUENTIAL(rank,bank)]);
+			}
+			break;
+		}
+		bankState.lastCommand = PRECHARGE;
+		scheduleStateChange(rank, bank, iniReader->tRP);
+		break;
+	case READ:
+		if(iniReader->SystemType == TYPE_NVM && iniReader->rowBufferPolicy == ClosePage)
+		{
+			bankState.currentBankState = Idle;
+			bankStates.closeRow(rank, bank);
+			resumeArrayWrite(rank, bank);
+		}
+		break;
+
+	case REFRESH:
+	case PRECHARGE:
+		if (arrayWriteEnd[SEQUENTIAL(rank,bank)] != 0)
+		{
+			checkArrayWrite(rank, bank);
+			break;
+		}
+		bankState.currentBankState = Idle;
+		resumeArrayWrite(rank, bank);
+		break;
+	default:
+		break;
+	}
+}
+
+//The array write of a WRITE_P, length cycles long, takes the bank from done
+//  cycles in; it's checked at the step boundaries and when a read waiting for
+//  the bank has waited WRITE_CANCEL_THRESHOLD cycles
+void MemoryController::startArrayWrite(unsigned rank, unsigned bank, unsigned length, unsigned done)
+{
+	size_t i = SEQUENTIAL(rank,bank);
+	arrayWriteStart[i] = currentClockCycle - done;
+	arrayWriteEnd[i] = arrayWriteStart[i] + length;
+	bankStates[rank][bank].nextActivate = max(arrayWriteEnd[i], bankStates[rank][bank].nextActivate);
+	scheduleArrayWriteCheck(rank, bank);
+}
+
+//the next cycle at which the array write may end, pause or be cancelled;
+//  the boundaries are only of interest while a read is waiting
+void MemoryController::scheduleArrayWriteCheck(unsigned rank, unsigned bank)
+{
+	size_t i = SEQUENTIAL(rank,bank);
+	uint64_t next = arrayWriteEnd[i];
+	BusPacket *read = commandQueue.nextRead(rank, bank);
+	if (read != NULL)
+	{
+		if (iniReader->WRITE_PAUSING && pausedArrayWrite[i] == 0)
+		{
+			for (unsigned k=1;k<iniReader->WRITE_ITERATIONS;k++)
+			{
+				uint64_t boundary = arrayWriteStart[i] + ARRAY_WRITE_TIME(k);
+				if (boundary > currentClockCycle)
+				{
+					next = min(next, boundary);
+					break;
+				}
+			}
+		}
+		if (iniReader->WRITE_CANCEL_THRESHOLD > 0)
+		{
+			uint64_t deadline = cancelDeadline(read);
+			if (deadline > currentClockCycle)
+			{
+				next = min(next, deadline);
+			}
+		}
+	}
+	if (next != bankStates[rank][bank].nextStateChange)
+	{
+		scheduleStateChange(rank, bank, next - currentClockCycle);
+	}
+}
+
+//the cycle from which a read waiting for a bank may cancel its array write
+uint64_t MemoryController::cancelDeadline(const BusPacket *read)
+{
+	Transaction *transaction = pendingReadTransactions.find(read->transactionID);
+	if (transaction == NULL)
+	{
+		ERROR("Can't find the transaction of a read waiting for rank "<<read->rank<<" bank "<<read->bank);
+		abort();
+	}
+	return transaction->timeAdded + iniReader->WRITE_CANCEL_THRESHOLD;
+}
+
+//The array write has come to its end or to a check. A read waiting for the
+//  bank cancels it if it has waited WRITE_CANCEL_THRESHOLD cycles, and the
+//  write is queued again behind the read; otherwise the read pauses it at a
+//  step boundary, unless the bank already has a write paused.
+void MemoryController::checkArrayWrite(unsigned rank, unsigned bank)
+{
+	size_t i = SEQUENTIAL(rank,bank);
+	if (currentClockCycle >= arrayWriteEnd[i])
+	{
+		arrayWriteEnd[i] = 0;
+		if (writingPacket[i] != NULL)
+		{
+			busPacketPool.release(writingPacket[i]);
+			writingPacket[i] = NULL;
+		}
+		bankStates[rank][bank].currentBankState = Idle;
+		resumeArrayWrite(rank, bank);
+		return;
+	}
+
+	BusPacket *read = commandQueue.nextRead(rank, bank);
+	if (read == NULL)
+	{
+		scheduleArrayWriteCheck(rank, bank);
+		return;
+	}
+	BusPacket *write = writingPacket[i];
+	if (write != NULL &&
+	        currentClockCycle >= cancelDeadline(read) &&
+	        commandQueue.hasRoomFor(2, rank, bank) &&
+	        !commandQueue.writeQueued(rank, bank, write->row, write->column))
+	{
+		writingPacket[i] = NULL;
+		commandQueue.enqueue(new (busPacketPool.allocate()) BusPacket(ACTIVATE, write->physicalAddress,
+				write->column, write->row, rank, bank, 0, 0, write->source));
+		commandQueue.enqueue(write);
+		interruptArrayWrite(rank, bank);
+		writesCancelled++;
+		return;
+	}
+	if (iniReader->WRITE_PAUSING && pausedArrayWrite[i] == 0)
+	{
+		for (unsigned k=1;k<iniReader->WRITE_ITERATIONS;k++)
+		{
+			if (arrayWriteStart[i] + ARRAY_WRITE_TIME(k) == currentClockCycle)
+			{
+				pausedArrayWrite[i] = arrayWriteEnd[i] - currentClockCycle;
+				pausedWriteLength[i] = arrayWriteEnd[i] - arrayWriteStart[i];
+				pausedPacket[i] = writingPacket[i];
+				writingPacket[i] = NULL;
+				interruptArrayWrite(rank, bank);
+				writesPaused++;
+				return;
+			}
+		}
+	}
+	scheduleArrayWriteCheck(rank, bank);
+}
+
+//leaves the bank idle for the read, which still has to keep tRRD from the
+//  last activate to the rank
+void MemoryController::interruptArrayWrite(unsigned rank, unsigned bank)
+{
+	arrayWriteEnd[SEQUENTIAL(rank,bank)] = 0;
+	bankStates[rank][bank].currentBankState = Idle;
+	bankStates[rank][bank].nextActivate = max(currentClockCycle, lastActivate[rank] + iniReader->tRRD);
+	bankStates[rank][bank].nextRead = currentClockCycle;
+	bankStates[rank][bank].nextWrite = currentClockCycle;
+}
+
+//a bank with a paused write goes back to it as soon as it's idle again
+void MemoryController::resumeArrayWrite(unsigned rank, unsigned bank)
+{
+	size_t i = SEQUENTIAL(rank,bank);
+	if (pausedArrayWrite[i] == 0)
+	{
+		return;
+	}
+	unsigned left = pausedArrayWrite[i];
+	pausedArrayWrite[i] = 0;
+	writingPacket[i] = pausedPacket[i];
+	pausedPacket[i] = NULL;
+	bankStates[rank][bank].currentBankState = Precharging;
+	bankStates[rank][bank].lastCommand = PRECHARGE;
+	startArrayWrite(rank, bank, pausedWriteLength[i], pausedWriteLength[i] - left);
+}
+
+//the SET-and-verify iterations the next array write needs
+unsigned MemoryController::drawWriteIterations()
+{
+	const vector<double> &odds = iniReader->writeIterationOdds;
+	if (odds.empty())
+	{
+		return iniReader->WRITE_ITERATIONS;
+	}
+	//53 random bits in [0,1); the std distributions are not reproducible across libraries
+	double p = (random() >> 11) * (1.0 / 9007199254740992.0);
+	unsigned k = 0;
+	while (k+1 < odds.size() && p >= odds[k])
+	{
+		k++;
+	}
+	return k+1;
+}
+
+//First cycle at which update() will do more than count down its timers and
+//  accumulate background energy: a command or data packet arrives, a bank
+//  changes state, a command can be issued, a transaction can be broken up or
+//  returned, a refresh falls due or a rank powers down or up. Until then the
+//  cycles can be skipped with fastForward().
+uint64_t MemoryController::nextEventCycle()
+{
+	//these print every cycle, skipping cycles would change the log
+	if (DEBUG_TRANS_Q || DEBUG_BANKSTATE || DEBUG_CMD_Q || DEBUG_POWER)
+	{
+		return currentClockCycle;
+	}
+	if (returnTransaction.size() > 0)
+	{
+		return currentClockCycle;
+	}
+
+	//a busy channel usually has something due right away, so the cheap sources
+	//  are looked at first and the search stops as soon as one of them is
+	uint64_t next = UINT64_MAX;
+	if (outgoingCmdPacket != NULL)
+	{
+		next = min(next, currentClockCycle + cmdCyclesLeft - 1);
+	}
+	if (outgoingDataPacket != NULL)
+	{
+		next = min(next, currentClockCycle + dataCyclesLeft - 1);
+	}
+	if (writeDataReady.size() > 0)
+	{
+		next = min(next, writeDataReady.front());
+	}
+	//bank state changes and tFAW windows
+	next = min(next, timingWheel.nextEventCycle());
+	if (iniReader->SystemType == TYPE_DRAM)
+	{
+		//the refresh is flagged once its cycle has come, and a powered down
+		//  rank is woken tXP ahead of that
+		next = min(next, nextRefresh[refreshRank]);
+		if (powerDown[refreshRank] && !(*ranks)[refreshRank]->refreshWaiting)
+		{
+			next = min(next, nextRefresh[refreshRank] > iniReader->tXP ? nextRefresh[refreshRank] - iniReader->tXP : 0);
+		}
+	}
+	for (size_t i=0;i<iniReader->NUM_RANKS && next > currentClockCycle;i++)
+	{
+		next = min(next, (*ranks)[i]->nextEventCycle());
+
+		if (iniReader->USE_LOW_POWER)
+		{
+			if (commandQueue.isEmpty(i) && !(*ranks)[i]->refreshWaiting)
+			{
+				//an awake rank whose banks are all idle powers down right away
+				bool allIdle = true;
+				for (size_t j=0;j<iniReader->NUM_BANKS;j++)
+				{
+					if (bankStates[i][j].currentBankState != Idle)
+					{
+						allIdle = false;
+						break;
+					}
+				}
+				if (allIdle)
+				{
+					return currentClockCycle;
+				}
+			}
+			else if (powerDown[i])
+			{
+				next = min(next, max(bankStates[i][0].nextPowerUp, currentClockCycle));
+			}
+		}
+	}
+	if (next <= currentClockCycle)
+	{
+		return currentClockCycle;
+	}
+
+	if ((transactionQueue.size() > 0 || writeQueue.size() > 0) && !transactionQueueStalled)
+	{
+		return currentClockCycle;
+	}
+	return max(min(next, commandQueue.nextEventCycle()), currentClockCycle);
+}
+
+//does the work of that many update() calls at once; currentClockCycle+cycles
+//  must not exceed nextEventCycle()
+void MemoryController::fastForward(uint64_t cycles)
+{
+	for (size_t i=0;i<iniReader->NUM_RANKS;i++)
+	{
+		bool bankOpen = false;
+		for (size_t j=0;j<iniReader->NUM_BANKS;j++)
+		{
+			if (bankStates[i][j].currentBankState == Refreshing ||
+			        bankStates[i][j].currentBankState == RowActive)
+			{
+				bankOpen = true;
+			}
+		}
+
+		//the energies are integral, so this is exactly the sum update() would build
+		if (bankOpen)
+		{
+			backgroundEnergy[i] += (double)cycles * (iniReader->IDD3N * iniReader->NUM_DEVICES);
+		}
+		else if (powerDown[i])
+		{
+			backgroundEnergy[i] += (double)cycles * (iniReader->IDD2P * iniReader->NUM_DEVICES);
+		}
+		else
+		{
+			backgroundEnergy[i] += (double)cycles * (iniReader->IDD2N * iniReader->NUM_DEVICES);
+		}
+	}
+	if (outgoingCmdPacket != NULL)
+	{
+		cmdCyclesLeft -= cycles;
+	}
+	if (outgoingDataPacket != NULL)
+	{
+		dataCyclesLeft -= cycles;
+	}
+	commandQueue.fastForward(cycles);
+	currentClockCycle += cycles;
+}
+
+//whether there is room for a transaction of either type
 bool MemoryController::WillAcceptTransaction()
 {
+	return WillAcceptTransaction(DATA_READ) && WillAcceptTransaction(DATA_WRITE);
+}
+
+bool MemoryController::WillAcceptTransaction(TransactionType type)
+{
+	if (type == DATA_WRITE && iniReader->WRITE_QUEUE_DEPTH > 0)
+	{
+		return writeQueue.size() < iniReader->WRITE_QUEUE_DEPTH;
+	}
 	return transactionQueue.size() < iniReader->TRANS_QUEUE_DEPTH;
 }
 
 //allows outside source to make request of memory system
 bool MemoryController::addTransaction(Transaction *trans)
 {
-	if (WillAcceptTransaction())
+	if (WillAcceptTransaction(trans->transactionType))
 	{
 		trans->timeAdded = currentClockCycle;
-		transactionQueue.push_back(trans);
+		if (!trans->mapped)
+		{
+			DecodedAddress decoded;
+			addressMapping.decode(trans->address, decoded);
+			trans->setMapping(decoded);
+		}
+		if (DEBUG_ADDR_MAP)
+		{
+			DEBUG("Mapped Ch="<<trans->channel<<" Rank="<<trans->rank
+					<<" Bank="<<trans->bank<<" Row="<<trans->row
+					<<" Col="<<trans->column<<"\n"); 
+		}
+		trans->id = nextTransactionID++;
+		//an id only has to outlive its transaction, so wrapping around is fine
+		if (nextTransactionID == 0)
+		{
+			nextTransactionID = 1;
+		}
+		transactionQueueStalled = false;
 		if(iniReader->SystemType == TYPE_DRAM)
 		{
 			if(trans->transactionType == DATA_WRITE)
@@ -995,6 +1365,18 @@ bool MemoryController::addTransaction(Transaction *trans)
 			}
 		
 		}
+		if (iniReader->WRITE_QUEUE_DEPTH == 0)
+		{
+			transactionQueue.push_back(trans);
+		}
+		else if (trans->transactionType == DATA_WRITE)
+		{
+			queueWrite(trans);
+		}
+		else if (!forwardRead(trans))
+		{
+			transactionQueue.push_back(trans);
+		}
 		return true;
 	}
 	else 
@@ -1003,6 +1385,83 @@ bool MemoryController::addTransaction(Transaction *trans)
 	}
 }
 
+//queues a write unless one to the same line is queued already, in which case
+//  the new data replaces the old and the write is done right away
+void MemoryController::queueWrite(Transaction *trans)
+{
+	uint64_t line = trans->address >> lineBitWidth;
+	unordered_map<uint64_t, Transaction *>::iterator queued = queuedWrites.find(line);
+	if (queued == queuedWrites.end())
+	{
+		queuedWrites[line] = trans;
+		writeQueue.push_back(trans);
+		return;
+	}
+#ifndef NO_STORAGE
+	queued->second->data = trans->data;
+#endif
+	writesMerged++;
+	if (parentMemorySystem->WriteDataDone!=NULL)
+	{
+		(*parentMemorySystem->WriteDataDone)(parentMemorySystem->systemID, trans->address, currentClockCycle);
+	}
+	transactionPool.release(trans);
+}
+
+//serves a read of a line with a write queued from that write's data, without
+//  going to the banks; the data goes back on the next update
+bool MemoryController::forwardRead(Transaction *trans)
+{
+	unordered_map<uint64_t, Transaction *>::iterator queued = queuedWrites.find(trans->address >> lineBitWidth);
+	if (queued == queuedWrites.end())
+	{
+		return false;
+	}
+	readsForwarded++;
+	//counted with the bank's reads so that the per bank and channel averages
+	//  take in its latency
+	totalReadsPerBank[SEQUENTIAL(trans->rank,trans->bank)]++;
+	pendingReadTransactions.insert(trans);
+	Transaction *returned = new (transactionPool.allocate()) Transaction(RETURN_DATA, trans->address, queued->second->getData());
+	returned->id = trans->id;
+	returnTransaction.push_back(returned);
+	return true;
+}
+
+//The oldest transaction whose bank has room in the command queue, NULL if
+//  there is none. With a write queue, reads go first until the writes reach the
+//  high watermark; the writes are then drained down to the low watermark in
+//  one batch, so that the data bus turns around once per batch rather than
+//  once per write. Writes also go whenever there are no reads waiting.
+Transaction *MemoryController::popTransaction()
+{
+	const vector<uint64_t> &room = commandQueue.getTransactionRoom();
+	if (iniReader->WRITE_QUEUE_DEPTH == 0)
+	{
+		return transactionQueue.popOldest(room);
+	}
+	if (!drainingWrites && writeQueue.size() >= iniReader->WRITE_HIGH_WATERMARK)
+	{
+		drainingWrites = true;
+		writeDrains++;
+	}
+	Transaction *transaction = NULL;
+	if (!drainingWrites)
+	{
+		transaction = transactionQueue.popOldest(room);
+	}
+	if (transaction == NULL && (drainingWrites || transactionQueue.size() == 0))
+	{
+		transaction = writeQueue.popOldest(room);
+		if (transaction != NULL)
+		{
+			queuedWrites.erase(transaction->address >> lineBitWidth);
+			drainingWrites = drainingWrites && writeQueue.size() > iniReader->WRITE_LOW_WATERMARK;
+		}
+	}
+	return transaction;
+}
+
 void MemoryController::resetStats()
 {
 	for (size_t i=0; i<iniReader->NUM_RANKS; i++)
@@ -1023,6 +1482,21 @@ void MemoryController::resetStats()
 		totalReadsPerRank[i] = 0;
 		totalWritesPerRank[i] = 0;
 	}
+	for (size_t i=0; i<totalReadsPerSource.size(); i++)
+	{
+		totalReadsPerSource[i] = 0;
+		totalWritesPerSource[i] = 0;
+		totalReadLatencyPerSource[i] = 0;
+	}
+	readToWriteTurnarounds = 0;
+	writeToReadTurnarounds = 0;
+	writeDrains = 0;
+	writesMerged = 0;
+	readsForwarded = 0;
+	writesPaused = 0;
+	writesCancelled = 0;
+	arrayWrites = 0;
+	totalWriteIterations = 0;
 }
 //prints statistics at the end of an epoch or  simulation
 void MemoryController::printStats(bool finalStats)
@@ -1159,6 +1633,63 @@ void MemoryController::printStats(bool finalStats)
 
 	}
 
+	//requests of each source, only worth printing when the channel is shared;
+	//	unfairness is the highest average read latency over the lowest
+	unsigned sourcesSeen = 0;
+	double maxSourceLatency = 0.0;
+	double minSourceLatency = 0.0;
+	for (size_t s=0; s<totalReadsPerSource.size(); s++)
+	{
+		if (totalReadsPerSource[s] + totalWritesPerSource[s] == 0)
+		{
+			continue;
+		}
+		sourcesSeen++;
+		if (totalReadsPerSource[s] == 0)
+		{
+			continue;
+		}
+		double latency = ((double)totalReadLatencyPerSource[s] / (double)totalReadsPerSource[s]) * iniReader->tCK;
+		if (minSourceLatency == 0.0 || latency < minSourceLatency)
+		{
+			minSourceLatency = latency;
+		}
+		maxSourceLatency = max(maxSourceLatency, latency);
+	}
+	double unfairness = minSourceLatency > 0.0 ? maxSourceLatency / minSourceLatency : 1.0;
+	if (sourcesSeen > 1)
+	{
+		for (size_t s=0; s<totalReadsPerSource.size(); s++)
+		{
+			if (totalReadsPerSource[s] + totalWritesPerSource[s] == 0)
+			{
+				continue;
+			}
+			PRINTN( "      -Source " << s << " : " << totalReadsPerSource[s] << " reads, " << totalWritesPerSource[s] << " writes");
+			PRINT( ", average read latency " << (totalReadsPerSource[s] == 0 ? 0.0 :
+			        ((double)totalReadLatencyPerSource[s] / (double)totalReadsPerSource[s]) * iniReader->tCK) << " ns");
+		}
+		PRINT( "   Unfairness (max/min average read latency) : " << unfairness );
+	}
+	PRINT( "   Average read latency : " << (totalReadsPerChannel == 0 ? 0.0 :
+	        ((double)totalChannelEpochLatency / (double)totalReadsPerChannel) * iniReader->tCK) << " ns" );
+	PRINT( "   Bus turnarounds : " << readToWriteTurnarounds + writeToReadTurnarounds << " (" << readToWriteTurnarounds
+	        << " read to write, " << writeToReadTurnarounds << " write to read)" );
+	if (iniReader->WRITE_QUEUE_DEPTH > 0)
+	{
+		PRINT( "   Write queue : " << writeDrains << " drains, " << writesMerged << " writes merged, "
+		        << readsForwarded << " reads forwarded" );
+	}
+	if (WRITES_INTERRUPTIBLE)
+	{
+		PRINT( "   Array writes : " << writesPaused << " paused, " << writesCancelled << " cancelled" );
+	}
+	if (!iniReader->writeIterationOdds.empty())
+	{
+		PRINT( "   Write iterations : " << (arrayWrites == 0 ? 0.0 : (double)totalWriteIterations / (double)arrayWrites)
+		        << " on average over " << arrayWrites << " array writes" );
+	}
+
 
 	if(VIS_FILE_OUTPUT)
 	{
@@ -1169,6 +1700,38 @@ void MemoryController::printStats(bool finalStats)
 
 		csvOut.getOutputStream()<<"totalReadsPerChannel["<<myChannel<<"]: "<<totalReadsPerChannel<<endl;
 		csvOut.getOutputStream()<<"totalWritesPerChannel["<<myChannel<<"]: "<<totalWritesPerChannel<<endl;
+		for (size_t s=0; s<totalReadsPerSource.size() && sourcesSeen > 1; s++)
+		{
+			if (totalReadsPerSource[s] + totalWritesPerSource[s] > 0)
+			{
+				csvOut.getOutputStream()<<"readsPerSource["<<myChannel<<"]["<<s<<"]: "<<totalReadsPerSource[s]<<endl;
+				csvOut.getOutputStream()<<"writesPerSource["<<myChannel<<"]["<<s<<"]: "<<totalWritesPerSource[s]<<endl;
+				csvOut.getOutputStream()<<"latency_read_source["<<myChannel<<"]["<<s<<"]: "<<(totalReadsPerSource[s] == 0 ? 0.0 :
+				        ((double)totalReadLatencyPerSource[s] / (double)totalReadsPerSource[s]) * iniReader->tCK)<<endl;
+			}
+		}
+		if (sourcesSeen > 1)
+		{
+			csvOut.getOutputStream()<<"unfairness["<<myChannel<<"]: "<<unfairness<<endl;
+		}
+		csvOut.getOutputStream()<<"readToWriteTurnarounds["<<myChannel<<"]: "<<readToWriteTurnarounds<<endl;
+		csvOut.getOutputStream()<<"writeToReadTurnarounds["<<myChannel<<"]: "<<writeToReadTurnarounds<<endl;
+		if (iniReader->WRITE_QUEUE_DEPTH > 0)
+		{
+			csvOut.getOutputStream()<<"writeQueueDrains["<<myChannel<<"]: "<<writeDrains<<endl;
+			csvOut.getOutputStream()<<"writesMerged["<<myChannel<<"]: "<<writesMerged<<endl;
+			csvOut.getOutputStream()<<"readsForwarded["<<myChannel<<"]: "<<readsForwarded<<endl;
+		}
+		if (WRITES_INTERRUPTIBLE)
+		{
+			csvOut.getOutputStream()<<"writesPaused["<<myChannel<<"]: "<<writesPaused<<endl;
+			csvOut.getOutputStream()<<"writesCancelled["<<myChannel<<"]: "<<writesCancelled<<endl;
+		}
+		if (!iniReader->writeIterationOdds.empty())
+		{
+			csvOut.getOutputStream()<<"writeIterations["<<myChannel<<"]: "<<(arrayWrites == 0 ? 0.0 :
+			        (double)totalWriteIterations / (double)arrayWrites)<<endl;
+		}
 
 		csvOut.getOutputStream()<<"totalPowerPerChannel["<<myChannel<<"]: "<<(totalBurstEnergyPerChennel+totalActpreEnergyPerChannel+totalActpreEnergyPerChannel)/powerDeno<<endl;
 		csvOut.getOutputStream()<<"totalEnergyPerChannel["<<myChannel<<"]: "<<totalBurstEnergyPerChennel+totalActpreEnergyPerChannel+totalActpreEnergyPerChannel<<endl<<endl;
@@ -1244,22 +1807,46 @@ MemoryController::~MemoryController()
 {
 	//ERROR("MEMORY CONTROLLER DESTRUCTOR");
 	//abort();
-	for (size_t i=0; i<pendingReadTransactions.size(); i++)
+	for (TransactionQueue::Handle h=transactionQueue.begin(); h!=transactionQueue.end(); h=transactionQueue.next(h))
+	{
+		transactionPool.release(transactionQueue[h]);
+	}
+	for (TransactionQueue::Handle h=writeQueue.begin(); h!=writeQueue.end(); h=writeQueue.next(h))
 	{
-		delete pendingReadTransactions[i];
+		transactionPool.release(writeQueue[h]);
+	}
+	for (size_t i=0; i<writingPacket.size(); i++)
+	{
+		busPacketPool.release(writingPacket[i]);
+		busPacketPool.release(pausedPacket[i]);
 	}
 
-	for (size_t i=0; i<pendingWriteTransactions.size(); i++)
+	for (size_t i=0; i<pendingReadTransactions.getNumSlots(); i++)
 	{
-		delete pendingWriteTransactions[i];
+		transactionPool.release(pendingReadTransactions.getSlot(i));
+	}
+
+	for (size_t i=0; i<pendingWriteTransactions.getNumSlots(); i++)
+	{
+		transactionPool.release(pendingWriteTransactions.getSlot(i));
 	}
 	
-	for (size_t i=0; i<returnTransaction.size(); i++)
+	while (!returnTransaction.empty())
+	{
+		transactionPool.release(returnTransaction.front());
+		returnTransaction.pop_front();
+	}
+
+	while (!writeDataToSend.empty())
 	{
-		delete returnTransaction[i];
+		busPacketPool.release(writeDataToSend.front());
+		writeDataToSend.pop_front();
 	}
+	busPacketPool.release(outgoingCmdPacket);
+	busPacketPool.release(outgoingDataPacket);
 
-	if(VIS_FILE_OUTPUT && iniReader->SystemType==TYPE_DRAM)
+	//the totals of the whole memory system are written once, by the first channel
+	if(VIS_FILE_OUTPUT && parentMemorySystem->systemID==0)
 	{
 
 		uint64_t totalWriteLatency_MS = 0;
@@ -1345,7 +1932,7 @@ MemoryController::~MemoryController()
 				n1 = 0;
 			}
 
-			csvOut.getOutputStream()<<"readLatency"<<m<<": "<<readLatency[n1]<<endl;
+			csvOut.getOutputStream()<<"readLatency"<<m<<": "<<(readLatency.empty() ? 0 : readLatency[n1])<<endl;
 
 		}
 		for(int m=1; m<=10; m++)
@@ -1355,7 +1942,7 @@ MemoryController::~MemoryController()
 			{
 				n2 = 0;
 			}
-			csvOut.getOutputStream()<<"writeLatency"<<m<<": "<<writeLatency[n2]<<endl;
+			csvOut.getOutputStream()<<"writeLatency"<<m<<": "<<(writeLatency.empty() ? 0 : writeLatency[n2])<<endl;
 		}
 
 		csvOut.getOutputStream()<<"end"<<endl;
@@ -1365,7 +1952,7 @@ MemoryController::~MemoryController()
 //inserts a latency into the latency histogram
 void MemoryController::insertHistogram(unsigned latencyValue, unsigned rank, unsigned bank)
 {
-	readLatency.push_back(latencyValue);
+	recordLatency(readLatency, latencyValue);
 	totalEpochLatency[SEQUENTIAL(rank,bank)] += latencyValue;
 	//poor man's way to bin things.
 	latencies[(latencyValue/HISTOGRAM_BIN_SIZE)*HISTOGRAM_BIN_SIZE]++;
@@ -46,7 +46,13 @@
 #include "Rank.h"
 #include "CSVWriter.h"
 #include "IniReader.h"
+#include "ObjectPool.h"
+#include "RingBuffer.h"
+#include "TransactionTable.h"
+#include "TransactionQueue.h"
 #include <map>
+#include <unordered_map>
+#include <random>
 
 using namespace std;
 
@@ -64,35 +70,92 @@ public:
 
 	bool addTransaction(Transaction *trans);
 	bool WillAcceptTransaction();
+	bool WillAcceptTransaction(TransactionType type);
 	void returnReadData(const Transaction *trans);
 	void receiveFromBus(BusPacket *bpacket);
 	void attachRanks(vector<Rank *> *ranks);
 	void update();
+	uint64_t nextEventCycle();
+	void fastForward(uint64_t cycles);
 	void printStats(bool finalStats = false);
 	void resetStats(); 
 
 
 	//fields
-	vector<Transaction *> transactionQueue;
+	TransactionQueue transactionQueue;
+	//writes, when they are kept apart from the reads (WRITE_QUEUE_DEPTH)
+	TransactionQueue writeQueue;
 private:
-  vector<IniReader *> allIniReaders;
+	const AddressMapping &addressMapping;
   IniReader * iniReader;
 	ostream &dramsim_log;
-	vector< vector <BankState> > bankStates;
+	BankStateTable &bankStates;
+	TimingWheel &timingWheel;
+	ObjectPool<BusPacket> &busPacketPool;
+	ObjectPool<Transaction> &transactionPool;
 	//functions
 	void insertHistogram(unsigned latencyValue, unsigned rank, unsigned bank);
+	void scheduleStateChange(unsigned rank, unsigned bank, unsigned delay);
+	void changeBankState(unsigned rank, unsigned bank);
+	void queueWrite(Transaction *trans);
+	bool forwardRead(Transaction *trans);
+	Transaction *popTransaction();
+	void startArrayWrite(unsigned rank, unsigned bank, unsigned length, unsigned done);
+	void scheduleArrayWriteCheck(unsigned rank, unsigned bank);
+	void checkArrayWrite(unsigned rank, unsigned bank);
+	void interruptArrayWrite(unsigned rank, unsigned bank);
+	void resumeArrayWrite(unsigned rank, unsigned bank);
+	uint64_t cancelDeadline(const BusPacket *read);
+	unsigned drawWriteIterations();
 
 	//fields
 	MemorySystem *parentMemorySystem;
 
 	CommandQueue commandQueue;
 	BusPacket *poppedBusPacket;
-	vector<unsigned>refreshCountdown;
-	vector<BusPacket *> writeDataToSend;
-	vector<unsigned> writeDataCountdown;
-	vector<Transaction *> returnTransaction;
-	vector<Transaction *> pendingReadTransactions;
-	vector<Transaction *> pendingWriteTransactions;
+	//none of the queued transactions found room in the command queue on the
+	//  last update; only a pop or a new transaction can change that
+	bool transactionQueueStalled;
+	//the write queued for each line (address>>lineBitWidth), which later
+	//  writes to the line are merged into and reads of it are served from
+	unordered_map<uint64_t, Transaction *> queuedWrites;
+	unsigned lineBitWidth;
+	//set from the high watermark until the write queue is down to the low one
+	bool drainingWrites;
+	//the data bus turns around between the last column command and the next
+	//  one if they go in opposite directions
+	bool lastColumnWasWrite;
+	bool columnIssued;
+	//with WRITES_INTERRUPTIBLE, the array write of each bank: the cycle it
+	//  started (less what it did before it was paused) and the cycle it ends,
+	//  0 while the bank isn't writing
+	vector<uint64_t> arrayWriteStart;
+	vector<uint64_t> arrayWriteEnd;
+	//cycles of array write left to the write paused in each bank, 0 if none
+	vector<unsigned> pausedArrayWrite;
+	//cycles of array write of the WRITE_P last issued to each bank, drawn
+	//  when it's issued, and of the write paused in it
+	vector<unsigned> writeLength;
+	vector<unsigned> pausedWriteLength;
+	std::mt19937_64 random;
+	//copies of the writing and the paused WRITE_P of each bank, to queue the
+	//  write again if it's cancelled; only kept with WRITE_CANCEL_THRESHOLD
+	vector<BusPacket *> writingPacket;
+	vector<BusPacket *> pausedPacket;
+	//cycle of the last activate to each rank, which holds off a bank cut
+	//  loose from its array write for tRRD
+	vector<uint64_t> lastActivate;
+	//cycle at which each rank is due for its next refresh
+	vector<uint64_t> nextRefresh;
+	RingBuffer<BusPacket *> writeDataToSend;
+	//cycle at which each packet of writeDataToSend goes on the data bus
+	RingBuffer<uint64_t> writeDataReady;
+	//timing events expired on the current cycle
+	vector<TimingEvent> dueEvents;
+	RingBuffer<Transaction *> returnTransaction;
+	//transactions turned into commands, by id, until their data has moved
+	TransactionTable pendingReadTransactions;
+	TransactionTable pendingWriteTransactions;
 	map<unsigned,unsigned> latencies; // latencyValue -> latencyCount
 	vector<bool> powerDown;
 
@@ -108,6 +171,8 @@ private:
 	unsigned dataCyclesLeft;
 
 	uint64_t totalTransactions;
+	//id of the next transaction accepted, 0 is left for packets of no transaction
+	uint32_t nextTransactionID;
 
 	vector<uint64_t> grandTotalBankAccesses; 
 	vector<uint64_t> totalReadsPerBank;
@@ -121,6 +186,21 @@ private:
 
 	vector< uint64_t > totalEpochLatency;
 	vector< uint64_t > totalEpochLatency_Write;
+
+	//by the source of the request (BusPacket::source), for the fairness stats
+	vector<uint64_t> totalReadsPerSource;
+	vector<uint64_t> totalWritesPerSource;
+	vector<uint64_t> totalReadLatencyPerSource;
+
+	uint64_t readToWriteTurnarounds;
+	uint64_t writeToReadTurnarounds;
+	uint64_t writeDrains;
+	uint64_t writesMerged;
+	uint64_t readsForwarded;
+	uint64_t writesPaused;
+	uint64_t writesCancelled;
+	uint64_t arrayWrites;
+	uint64_t totalWriteIterations;
 	
 	unsigned channelBitWidth;
 	unsigned rankBitWidth;
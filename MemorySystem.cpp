@@ -50,9 +50,13 @@ namespace DRAMSim {
 
 powerCallBack_t MemorySystem::ReportPower = NULL;
 
-MemorySystem::MemorySystem(unsigned id, CSVWriter &csvOut_, ostream &dramsim_log_, vector<IniReader *> allIniReaders_) :
+MemorySystem::MemorySystem(unsigned id, CSVWriter &csvOut_, ostream &dramsim_log_, vector<IniReader *> allIniReaders_, const AddressMapping &addressMapping_) :
     allIniReaders(allIniReaders_),
 		dramsim_log(dramsim_log_),
+		addressMapping(addressMapping_),
+		bankStates(allIniReaders_[id]->NUM_RANKS, allIniReaders_[id]->NUM_BANKS),
+		busPacketPool("BusPacket"),
+		transactionPool("Transaction"),
 		ReturnReadData(NULL),
 		WriteDataDone(NULL),
 		systemID(id),
@@ -111,6 +115,15 @@ MemorySystem::MemorySystem(unsigned id, CSVWriter &csvOut_, ostream &dramsim_log
 
 	DEBUG("CH. " <<systemID<<" TOTAL_STORAGE : "<< iniReader->TOTAL_STORAGE << "MB | "<<iniReader->NUM_RANKS<<" Ranks | "<< iniReader->NUM_DEVICES <<" Devices per rank");
 
+	//bus packets keep their coordinates in bit fields
+	if (iniReader->NUM_RANKS > (1U<<BUSPACKET_RANK_BITS) || iniReader->NUM_BANKS > (1U<<BUSPACKET_BANK_BITS) ||
+	        iniReader->NUM_COLS > (1U<<BUSPACKET_COLUMN_BITS))
+	{
+		ERROR("== Error - CH. "<<systemID<<" has more than "<<(1U<<BUSPACKET_RANK_BITS)<<" ranks, "<<(1U<<BUSPACKET_BANK_BITS)
+		      <<" banks or "<<(1U<<BUSPACKET_COLUMN_BITS)<<" columns, which BusPacket can't address");
+		exit(-1);
+	}
+
 
 	memoryController = new MemoryController(this, csvOut, dramsim_log);
 
@@ -119,7 +132,7 @@ MemorySystem::MemorySystem(unsigned id, CSVWriter &csvOut_, ostream &dramsim_log
 
 	for (size_t i=0; i<iniReader->NUM_RANKS; i++)
 	{
-		Rank *r = new Rank(dramsim_log,iniReader);
+		Rank *r = new Rank(dramsim_log,iniReader,busPacketPool);
 		r->setId(i);
 		r->attachMemoryController(memoryController);
 		ranks->push_back(r);
@@ -146,6 +159,11 @@ MemorySystem::~MemorySystem()
 	ranks->clear();
 	delete(ranks);
 
+	for (size_t i=0; i<pendingTransactions.size(); i++)
+	{
+		transactionPool.release(pendingTransactions[i]);
+	}
+
 	if (VERIFICATION_OUTPUT)
 	{
 		cmd_verify_out.flush();
@@ -158,14 +176,42 @@ bool MemorySystem::WillAcceptTransaction()
 	return memoryController->WillAcceptTransaction();
 }
 
+//reads and writes may wait in separate queues
+bool MemorySystem::WillAcceptTransaction(TransactionType type)
+{
+	return memoryController->WillAcceptTransaction(type);
+}
+
+//first cycle at which update() can change the state of the channel
+uint64_t MemorySystem::nextEventCycle()
+{
+	if (pendingTransactions.size() > 0 && memoryController->WillAcceptTransaction(pendingTransactions.front()->transactionType))
+	{
+		return currentClockCycle;
+	}
+	return memoryController->nextEventCycle();
+}
+
+//advances the channel as if update() had been called cycles times, which
+//  must not take it past nextEventCycle()
+void MemorySystem::fastForward(uint64_t cycles)
+{
+	for (size_t i=0;i<iniReader->NUM_RANKS;i++)
+	{
+		(*ranks)[i]->fastForward(cycles);
+	}
+	memoryController->fastForward(cycles);
+	currentClockCycle += cycles;
+}
+
 bool MemorySystem::addTransaction(bool isWrite, uint64_t addr)
 {
 	TransactionType type = isWrite ? DATA_WRITE : DATA_READ;
-	Transaction *trans = new Transaction(type,addr,NULL);
+	Transaction *trans = new (transactionPool.allocate()) Transaction(type,addr,NULL);
 	// push_back in memoryController will make a copy of this during
 	// addTransaction so it's kosher for the reference to be local 
 
-	if (memoryController->WillAcceptTransaction()) 
+	if (memoryController->WillAcceptTransaction(type)) 
 	{
 		return memoryController->addTransaction(trans);
 	}
@@ -176,11 +222,22 @@ bool MemorySystem::addTransaction(bool isWrite, uint64_t addr)
 	}
 }
 
+//trans has to come from transactionPool, the controller releases it once it's done
 bool MemorySystem::addTransaction(Transaction *trans)
 {
 	return memoryController->addTransaction(trans);
 }
 
+//copies trans into the pool if the controller has room for it
+bool MemorySystem::addTransaction(const Transaction &trans)
+{
+	if (!memoryController->WillAcceptTransaction(trans.transactionType))
+	{
+		return false;
+	}
+	return memoryController->addTransaction(new (transactionPool.allocate()) Transaction(trans));
+}
+
 //prints statistics
 void MemorySystem::printStats(bool finalStats)
 {
@@ -202,7 +259,7 @@ void MemorySystem::update()
 	}
 
 	//pendingTransactions will only have stuff in it if MARSS is adding stuff
-	if (pendingTransactions.size() > 0 && memoryController->WillAcceptTransaction())
+	if (pendingTransactions.size() > 0 && memoryController->WillAcceptTransaction(pendingTransactions.front()->transactionType))
 	{
 		memoryController->addTransaction(pendingTransactions.front());
 		pendingTransactions.pop_front();
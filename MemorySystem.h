@@ -45,6 +45,7 @@
 #include "Transaction.h"
 #include "Callback.h"
 #include "CSVWriter.h"
+#include "ObjectPool.h"
 #include <deque>
 
 namespace DRAMSim
@@ -54,13 +55,17 @@ class MemorySystem : public SimulatorObject
 {
 public:
 	//functions
-	MemorySystem(unsigned id, CSVWriter &csvOut_, ostream &dramsim_log_, vector<IniReader *> allIniReaders);
+	MemorySystem(unsigned id, CSVWriter &csvOut_, ostream &dramsim_log_, vector<IniReader *> allIniReaders, const AddressMapping &addressMapping_);
 	virtual ~MemorySystem();
 	void update();
 	bool addTransaction(Transaction *trans);
+	bool addTransaction(const Transaction &trans);
 	bool addTransaction(bool isWrite, uint64_t addr);
 	void printStats(bool finalStats);
 	bool WillAcceptTransaction();
+	bool WillAcceptTransaction(TransactionType type);
+	uint64_t nextEventCycle();
+	void fastForward(uint64_t cycles);
 	void RegisterCallbacks(
 	    Callback_t *readDone,
 	    Callback_t *writeDone,
@@ -70,6 +75,17 @@ public:
   vector<IniReader *> allIniReaders;
   IniReader * iniReader;
 	ostream &dramsim_log;
+	//deadlines of the bank state changes and tFAW windows of this channel
+	TimingWheel timingWheel;
+	//shared by all channels
+	const AddressMapping &addressMapping;
+	//the one bank state model of the channel, the controller schedules by it
+	BankStateTable bankStates;
+	//every bus packet and transaction inside the channel comes from these;
+	//  they are declared ahead of the controller and ranks which release
+	//  into them when they are destroyed
+	ObjectPool<BusPacket> busPacketPool;
+	ObjectPool<Transaction> transactionPool;
 	MemoryController *memoryController;
 	vector<Rank *> *ranks;
 	deque<Transaction *> pendingTransactions; 
@@ -42,6 +42,9 @@
 
 using namespace DRAMSim; 
 
+//yields of a worker that runs out of cycles before it goes to sleep
+#define WORKER_SPIN_COUNT 64
+
 //add baseAddr field, 'cause pcm need it
 MultiChannelMemorySystem::MultiChannelMemorySystem(
       const string &debugIniFilename_, 
@@ -66,9 +69,9 @@ MultiChannelMemorySystem::MultiChannelMemorySystem(
   traceFilename(traceFilename_),
 	pwd(pwd_), 
   visFilename(visFilename_), 
-	clockDomainCrosser(new ClockDomain::Callback<MultiChannelMemorySystem, void>(this, &MultiChannelMemorySystem::actual_update)),
-	clockDomainCrosserPcm(new ClockDomain::Callback<MultiChannelMemorySystem, void>(this, &MultiChannelMemorySystem::actual_update_pcm)),
-	csvOut(new CSVWriter(visDataOut))
+	csvOut(new CSVWriter(visDataOut)),
+	parallelFastForward(false),
+	callbacksRegistered(false)
 {
 	currentClockCycle=0; 
 	if (visFilename)
@@ -111,51 +114,39 @@ MultiChannelMemorySystem::MultiChannelMemorySystem(
 		}
 	}
 
-  IniReader *iniReaderDram=new IniReader(TYPE_DRAM,megsOfMemory);
-  IniReader *iniReaderPcm=new IniReader(TYPE_NVM,megsOfMemoryPcm);
-	DEBUG("== Loading device model file '"<<deviceIniFilename<<"' == ");
-	iniReaderDram->ReadIniFile(deviceIniFilename, false);
-	DEBUG("== Loading device model file '"<<deviceIniFilenamePcm<<"' == ");
-	iniReaderPcm->ReadIniFile(deviceIniFilenamePcm, false);
-	DEBUG("== Loading system model file '"<<systemIniFilename<<"' == ");
-	iniReaderDram->ReadIniFile(systemIniFilename, true);
-	DEBUG("== Loading system model file '"<<systemIniFilenamePcm<<"' == ");
-	iniReaderPcm->ReadIniFile(systemIniFilenamePcm, true);
-	DEBUG("== Loading system model file '"<<debugIniFilename<<"' == ");
-	iniReaderDram->ReadIniFile(debugIniFilename, true);
-	iniReaderPcm->ReadIniFile(debugIniFilename, true);
-
-	// If we have any overrides, set them now before creating all of the memory objects
-  /*
-	if (paramOverrides)
-		iniReaderDram->OverrideKeys(paramOverrides);
-	if (paramOverridesPcm)
-		iniReaderPcm->OverrideKeys(paramOverridesPcm);
-    */
-
-	iniReaderDram->InitEnumsFromStrings();
-	iniReaderPcm->InitEnumsFromStrings();
-	if (!iniReaderDram->CheckIfAllSet())
-	{
-		exit(-1);
-	}
-	if (!iniReaderPcm->CheckIfAllSet())
+	//every channel gets an IniReader of its own; the first one of each memory
+	//  type says how many channels of that type to split its storage over
+	for (unsigned systemType=TYPE_DRAM; systemType<=TYPE_NVM; systemType++)
 	{
-		exit(-1);
+		unsigned megs = systemType == TYPE_DRAM ? megsOfMemory : megsOfMemoryPcm;
+		IniReader *iniReader = loadIniReader(systemType, megs);
+		unsigned numChannels = iniReader->NUM_CHANS;
+		if (numChannels == 0 || !isPowerOfTwo(numChannels) || numChannels > megs)
+		{
+			ERROR("NUM_CHANS="<<numChannels<<" has to be a power of two no larger than the "<<megs<<"MB of "<<(systemType == TYPE_DRAM ? "DRAM" : "NVM"));
+			abort();
+		}
+		if (numChannels == 1)
+		{
+			allIniReaders.push_back(iniReader);
+			continue;
+		}
+		delete iniReader;
+		for (unsigned i=0; i<numChannels; i++)
+		{
+			allIniReaders.push_back(loadIniReader(systemType, megs/numChannels));
+		}
 	}
-  allIniReaders.push_back(iniReaderDram);
-  allIniReaders.push_back(iniReaderPcm);
+	NUM_CHANS = allIniReaders.size();
+	addressMapping = new AddressMapping(allIniReaders);
 
-	if (NUM_CHANS == 0) 
+//SystemIDchannelIDΪչ㣬SystemIDڴͽ
+	for (unsigned i=0; i<NUM_CHANS; i++)
 	{
-		ERROR("Zero channels"); 
-		abort(); 
+		channels.push_back(new MemorySystem(i, (*csvOut), dramsim_log,allIniReaders,*addressMapping));
+		clockDomainCrossers.push_back(new ClockDomain::ClockDomainCrosser(new ClockDomain::Callback<MemorySystem, void>(channels[i], &MemorySystem::update)));
 	}
-//SystemIDchannelIDΪչ㣬SystemIDڴͽ
-	MemorySystem *channel = new MemorySystem(0, (*csvOut), dramsim_log,allIniReaders);
-	MemorySystem *channelPcm = new MemorySystem(1, (*csvOut), dramsim_log,allIniReaders);
-	channels.push_back(channel);
-	channels.push_back(channelPcm);
+	channelCycles.resize(channels.size(), 0);
 	// for compatibility with the old marss code which assumed an sg15 part with a
 	// 2GHz CPU, the new code will reset this value later
 	setCPUClockSpeed(2000000000UL); 
@@ -167,12 +158,45 @@ MultiChannelMemorySystem::MultiChannelMemorySystem(
 void MultiChannelMemorySystem::setCPUClockSpeed(uint64_t cpuClkFreqHz)
 {
 
-	uint64_t dramsimClkFreqHz = (uint64_t)(1.0/(allIniReaders[TYPE_DRAM]->tCK*1e-9));
-	uint64_t dramsimClkFreqHzPcm = (uint64_t)(1.0/(allIniReaders[TYPE_NVM]->tCK*1e-9));
-	clockDomainCrosser.clock1 = dramsimClkFreqHz; 
-	clockDomainCrosser.clock2 = (cpuClkFreqHz == 0) ? dramsimClkFreqHz : cpuClkFreqHz; 
-	clockDomainCrosserPcm.clock1 = dramsimClkFreqHzPcm; 
-	clockDomainCrosserPcm.clock2 = (cpuClkFreqHz == 0) ? dramsimClkFreqHzPcm : cpuClkFreqHz; 
+	for (size_t i=0; i<clockDomainCrossers.size(); i++)
+	{
+		uint64_t dramsimClkFreqHz = (uint64_t)(1.0/(allIniReaders[i]->tCK*1e-9));
+		clockDomainCrossers[i]->clock1 = dramsimClkFreqHz; 
+		clockDomainCrossers[i]->clock2 = (cpuClkFreqHz == 0) ? dramsimClkFreqHz : cpuClkFreqHz; 
+	}
+}
+
+//reads the device, system and debug ini files for one channel of the given type
+IniReader *MultiChannelMemorySystem::loadIniReader(unsigned systemType, unsigned megsOfStorage)
+{
+	const string &deviceIni = systemType == TYPE_DRAM ? deviceIniFilename : deviceIniFilenamePcm;
+	const string &systemIni = systemType == TYPE_DRAM ? systemIniFilename : systemIniFilenamePcm;
+	IniReader *iniReader = new IniReader(systemType, megsOfStorage);
+	DEBUG("== Loading device model file '"<<deviceIni<<"' == ");
+	iniReader->ReadIniFile(deviceIni, false);
+	DEBUG("== Loading system model file '"<<systemIni<<"' == ");
+	iniReader->ReadIniFile(systemIni, true);
+	DEBUG("== Loading system model file '"<<debugIniFilename<<"' == ");
+	iniReader->ReadIniFile(debugIniFilename, true);
+
+	// If we have any overrides, set them now before creating all of the memory objects
+  /*
+	if (paramOverrides)
+		iniReader->OverrideKeys(paramOverrides);
+    */
+
+	iniReader->InitEnumsFromStrings();
+	if (!iniReader->CheckIfAllSet())
+	{
+		exit(-1);
+	}
+	return iniReader;
+}
+
+//first channel of the given memory type, the DRAM channels come first
+IniReader *MultiChannelMemorySystem::tierIniReader(unsigned systemType)
+{
+	return allIniReaders[systemType == TYPE_DRAM ? 0 : allIniReaders[0]->NUM_CHANS];
 }
 
 bool fileExists(string &path)
@@ -323,28 +347,62 @@ void MultiChannelMemorySystem::InitOutputFiles(string traceFilename)
 			// finally, figure out the filename
 			string sched = "BtR";
 			string queue = "pRank";
-			if (allIniReaders[TYPE_DRAM]->schedulingPolicy == RankThenBankRoundRobin)
+			IniReader *dram = tierIniReader(TYPE_DRAM);
+			IniReader *nvm = tierIniReader(TYPE_NVM);
+			if (dram->schedulingPolicy == RankThenBankRoundRobin)
 			{
 				sched = "RtB";
 			}
-			if (allIniReaders[TYPE_DRAM]->queuingStructure == PerRankPerBank)
+			else if (dram->schedulingPolicy == FirstReadyFCFS)
+			{
+				sched = "FRFCFS";
+			}
+			else if (dram->schedulingPolicy == Atlas)
+			{
+				sched = "ATLAS";
+			}
+			else if (dram->schedulingPolicy == Bliss)
+			{
+				sched = "BLISS";
+			}
+			else if (dram->schedulingPolicy == ParBS)
+			{
+				sched = "PARBS";
+			}
+			if (dram->queuingStructure == PerRankPerBank)
 			{
 				queue = "pRankpBank";
 			}
 			string schedPcm = "BtR";
 			string queuePcm = "pRank";
-			if (allIniReaders[TYPE_NVM]->schedulingPolicy == RankThenBankRoundRobin)
+			if (nvm->schedulingPolicy == RankThenBankRoundRobin)
 			{
 				schedPcm = "RtB";
 			}
-			if (allIniReaders[TYPE_NVM]->queuingStructure == PerRankPerBank)
+			else if (nvm->schedulingPolicy == FirstReadyFCFS)
+			{
+				schedPcm = "FRFCFS";
+			}
+			else if (nvm->schedulingPolicy == Atlas)
+			{
+				schedPcm = "ATLAS";
+			}
+			else if (nvm->schedulingPolicy == Bliss)
+			{
+				schedPcm = "BLISS";
+			}
+			else if (nvm->schedulingPolicy == ParBS)
+			{
+				schedPcm = "PARBS";
+			}
+			if (nvm->queuingStructure == PerRankPerBank)
 			{
 				queuePcm = "pRankpBank";
 			}
 
 			/* I really don't see how "the C++ way" is better than snprintf()  */
-			out <<"DRAM:"<< (allIniReaders[TYPE_DRAM]->TOTAL_STORAGE>>10) << "GB." << NUM_CHANS << "Ch." << allIniReaders[TYPE_DRAM]->NUM_RANKS <<"R." <<allIniReaders[TYPE_DRAM]->ADDRESS_MAPPING_SCHEME<<"."<<allIniReaders[TYPE_DRAM]->ROW_BUFFER_POLICY<<"."<< allIniReaders[TYPE_DRAM]->TRANS_QUEUE_DEPTH<<"TQ."<<allIniReaders[TYPE_DRAM]->CMD_QUEUE_DEPTH<<"CQ."<<sched<<"."<<queue;
-			out <<"NVM:"<< (allIniReaders[TYPE_NVM]->TOTAL_STORAGE>>10) << "GB." << NUM_CHANS << "Ch." << allIniReaders[TYPE_NVM]->NUM_RANKS <<"R." <<allIniReaders[TYPE_NVM]->ADDRESS_MAPPING_SCHEME<<"."<<allIniReaders[TYPE_NVM]->ROW_BUFFER_POLICY<<"."<< allIniReaders[TYPE_NVM]->TRANS_QUEUE_DEPTH<<"TQ."<<allIniReaders[TYPE_NVM]->CMD_QUEUE_DEPTH<<"CQ."<<schedPcm<<"."<<queuePcm;
+			out <<"DRAM:"<< ((dram->TOTAL_STORAGE*dram->NUM_CHANS)>>10) << "GB." << dram->NUM_CHANS << "Ch." << dram->NUM_RANKS <<"R." <<dram->ADDRESS_MAPPING_SCHEME<<"."<<dram->ROW_BUFFER_POLICY<<"."<< dram->TRANS_QUEUE_DEPTH<<"TQ."<<dram->CMD_QUEUE_DEPTH<<"CQ."<<sched<<"."<<queue;
+			out <<"NVM:"<< ((nvm->TOTAL_STORAGE*nvm->NUM_CHANS)>>10) << "GB." << nvm->NUM_CHANS << "Ch." << nvm->NUM_RANKS <<"R." <<nvm->ADDRESS_MAPPING_SCHEME<<"."<<nvm->ROW_BUFFER_POLICY<<"."<< nvm->TRANS_QUEUE_DEPTH<<"TQ."<<nvm->CMD_QUEUE_DEPTH<<"CQ."<<schedPcm<<"."<<queuePcm;
 		}
 		else //visFilename given
 		{
@@ -437,13 +495,18 @@ void MultiChannelMemorySystem::mkdirIfNotExist(string path)
 
 MultiChannelMemorySystem::~MultiChannelMemorySystem()
 {
+	stopParallel();
 	for (size_t i=0; i<NUM_CHANS; i++)
 	{
 		delete channels[i];
     delete allIniReaders[i];
+		delete clockDomainCrossers[i]->callback;
+		delete clockDomainCrossers[i];
 	}
+	clockDomainCrossers.clear();
 	channels.clear(); 
   allIniReaders.clear();
+	delete addressMapping;
 
 // flush our streams and close them up
 #ifdef LOG_OUTPUT
@@ -458,64 +521,291 @@ MultiChannelMemorySystem::~MultiChannelMemorySystem()
 }
 void MultiChannelMemorySystem::update()
 {
-	clockDomainCrosser.update(); 
-	clockDomainCrosserPcm.update(); 
+	if (workers.size() > 0)
+	{
+		//the workers pick the new cycle up by themselves
+		currentClockCycle++;
+		for (size_t i=0; i<workers.size(); i++)
+		{
+			workers[i]->observed = false;
+			grant(i, currentClockCycle);
+		}
+		return;
+	}
+	for (size_t i=0; i<channels.size(); i++)
+	{
+		updateChannel(i);
+	}
   //Since there are two actual_update functions, move it here in case currentClockCycle is increase twice.
 	currentClockCycle++; 
 }
-void MultiChannelMemorySystem::actual_update() 
+//Skips up to maxCycles cpu cycles without changing the outcome of the
+//  simulation and returns how many were skipped. Cycles on which neither
+//  memory clock ticks are always free; memory cycles are skipped up to the
+//  next event of the channel. The caller must not add transactions in between.
+uint64_t MultiChannelMemorySystem::fastForward(uint64_t maxCycles)
 {
-	if (currentClockCycle == 0)
+	uint64_t cycles = maxCycles;
+	if (workers.size() > 0)
 	{
-		InitOutputFiles(traceFilename);
-		DEBUG("HRAMSim1(DRAM) Clock Frequency ="<<clockDomainCrosser.clock1<<"Hz, CPU Clock Frequency="<<clockDomainCrosser.clock2<<"Hz"); 
+		//the workers skip quiet cycles by themselves, the front end only has
+		//  to stop at the next event of the channels it has looked at
+		for (size_t i=0; i<workers.size(); i++)
+		{
+			if (workers[i]->observed)
+			{
+				cycles = channelQuietCycles(i, cycles);
+			}
+		}
+		if (cycles == 0)
+		{
+			return 0;
+		}
+		currentClockCycle += cycles;
+		for (size_t i=0; i<workers.size(); i++)
+		{
+			workers[i]->observed = false;
+			grant(i, currentClockCycle);
+		}
+		return cycles;
+	}
+	for (size_t i=0; i<channels.size(); i++)
+	{
+		cycles = channelQuietCycles(i, cycles);
+	}
+	if (cycles == 0)
+	{
+		return 0;
+	}
+	for (size_t i=0; i<channels.size(); i++)
+	{
+		skipChannel(i, cycles);
 	}
+	currentClockCycle += cycles;
+	return cycles;
+}
 
-	if (currentClockCycle % allIniReaders[TYPE_DRAM]->EPOCH_LENGTH == 0)
+//one cpu cycle of a single channel
+void MultiChannelMemorySystem::updateChannel(unsigned channelNumber)
+{
+	if (channelCycles[channelNumber] == 0 && workers.size() == 0)
 	{
-		//(*csvOut) << "ms" <<currentClockCycle * allIniReaders[TYPE_DRAM]->tCK * 1E-6; 
-		//	channels[TYPE_DRAM]->printStats(false); 
-		csvOut->finalize();
+		firstCycleOutput(channelNumber);
 	}
-	
-	channels[TYPE_DRAM]->update(); 
+	clockDomainCrossers[channelNumber]->update();
+	channelCycles[channelNumber]++;
+}
+
+//number of cpu cycles, up to maxCycles, in which the channel's state can't change
+uint64_t MultiChannelMemorySystem::channelQuietCycles(unsigned channelNumber, uint64_t maxCycles)
+{
+	//the very first update opens the output files
+	if (channelCycles[channelNumber] == 0)
+	{
+		return 0;
+	}
+	ClockDomain::ClockDomainCrosser &crosser = *clockDomainCrossers[channelNumber];
+	//a channel whose clock doesn't tick within the window needn't be asked
+	if (maxCycles <= crosser.updatesWithin(0))
+	{
+		return maxCycles;
+	}
+	MemorySystem *channel = channels[channelNumber];
+	return min(maxCycles, crosser.updatesWithin(channel->nextEventCycle() - channel->currentClockCycle));
+}
+
+void MultiChannelMemorySystem::skipChannel(unsigned channelNumber, uint64_t cycles)
+{
+	channels[channelNumber]->fastForward(clockDomainCrossers[channelNumber]->skip(cycles));
+	channelCycles[channelNumber] += cycles;
 }
-void MultiChannelMemorySystem::actual_update_pcm() 
+
+//Moves every channel onto a worker thread of its own. From then on update()
+//  only advances the front end's clock and the channels catch up with it in
+//  the background, running ahead as far as setHorizon() allows. Whatever
+//  looks at a channel waits for it to catch up first, so the results are the
+//  same as in the sequential mode. Returns false and stays sequential when
+//  callbacks or debug output would interleave differently across channels.
+bool MultiChannelMemorySystem::startParallel(bool fastForward)
 {
+	if (callbacksRegistered)
+	{
+		PRINT("== Completion callbacks are registered, the channels are updated sequentially");
+		return false;
+	}
+	if (DEBUG_TRANS_Q || DEBUG_CMD_Q || DEBUG_ADDR_MAP || DEBUG_BANKSTATE || DEBUG_BUS || DEBUG_BANKS || DEBUG_POWER || VERIFICATION_OUTPUT)
+	{
+		PRINT("== Debug output is on, the channels are updated sequentially");
+		return false;
+	}
 	if (currentClockCycle == 0)
 	{
-//only do this in actual_update for dram		InitOutputFiles(traceFilename);
+		for (size_t i=0; i<channels.size(); i++)
+		{
+			firstCycleOutput(i);
+		}
+	}
+	parallelFastForward = fastForward;
+	for (size_t i=0; i<channels.size(); i++)
+	{
+		ChannelWorker *worker = new ChannelWorker();
+		worker->horizon = currentClockCycle;
+		worker->progress = currentClockCycle;
+		worker->sleeping = false;
+		worker->stop = false;
+		worker->observed = false;
+		workers.push_back(worker);
+	}
+	for (size_t i=0; i<workers.size(); i++)
+	{
+		workers[i]->thread = thread(&MultiChannelMemorySystem::runWorker, this, i);
+	}
+	return true;
+}
 
-		DEBUG("HRAMSim1(NVM) Clock Frequency ="<<clockDomainCrosserPcm.clock1<<"Hz, CPU Clock Frequency="<<clockDomainCrosserPcm.clock2<<"Hz"); 
+//The front end promises not to touch the channel before the clock reaches
+//  cycle and to keep the clock going at least that far, which lets the
+//  channel's worker run ahead up to there.
+void MultiChannelMemorySystem::setHorizon(unsigned channelNumber, uint64_t cycle)
+{
+	if (workers.size() > 0)
+	{
+		grant(channelNumber, cycle);
 	}
+}
 
-	if (currentClockCycle % allIniReaders[TYPE_NVM]->EPOCH_LENGTH == 0)
+void MultiChannelMemorySystem::runWorker(unsigned channelNumber)
+{
+	ChannelWorker &worker = *workers[channelNumber];
+	uint64_t cycle = worker.progress.load(std::memory_order_relaxed);
+	while (true)
 	{
-		//(*csvOut) << "ms" <<currentClockCycle * allIniReaders[TYPE_NVM]->tCK * 1E-6; 
-		//	channels[TYPE_NVM]->printStats(false); 
-		csvOut->finalize();
+		uint64_t horizon = worker.horizon.load(std::memory_order_acquire);
+		if (cycle == horizon)
+		{
+			if (!waitForHorizon(worker, cycle))
+			{
+				return;
+			}
+			continue;
+		}
+		uint64_t cycles = parallelFastForward ? channelQuietCycles(channelNumber, horizon - cycle) : 0;
+		if (cycles > 0)
+		{
+			skipChannel(channelNumber, cycles);
+		}
+		else
+		{
+			updateChannel(channelNumber);
+			cycles = 1;
+		}
+		cycle += cycles;
+		worker.progress.store(cycle, std::memory_order_release);
 	}
-	
-	channels[TYPE_NVM]->update(); 
 }
-unsigned MultiChannelMemorySystem::findChannelNumber(uint64_t addr)
+
+//parks the worker until the horizon moves past cycle, false once it is stopped
+bool MultiChannelMemorySystem::waitForHorizon(ChannelWorker &worker, uint64_t cycle)
 {
-	// Single channel case is a trivial shortcut case 
-	if (NUM_CHANS == 1)
+	//the front end usually grants the next cycle right away
+	for (unsigned i=0; i<WORKER_SPIN_COUNT; i++)
+	{
+		if (worker.horizon.load(std::memory_order_acquire) != cycle)
+		{
+			return true;
+		}
+		if (worker.stop.load(std::memory_order_relaxed))
+		{
+			return false;
+		}
+		std::this_thread::yield();
+	}
+	std::unique_lock<std::mutex> lock(worker.lock);
+	//pairs with grant() storing the horizon before it reads sleeping: either
+	//  the new horizon is seen here or grant() sees the worker asleep
+	worker.sleeping = true;
+	while (worker.horizon.load() == cycle && !worker.stop)
 	{
-		return 0; 
+		worker.wake.wait(lock);
 	}
+	worker.sleeping = false;
+	return worker.horizon.load() != cycle;
+}
 
-	if (!isPowerOfTwo(NUM_CHANS))
+void MultiChannelMemorySystem::grant(unsigned channelNumber, uint64_t cycle)
+{
+	ChannelWorker &worker = *workers[channelNumber];
+	//only this thread raises the horizon
+	if (cycle <= worker.horizon.load(std::memory_order_relaxed))
 	{
-		ERROR("We can only support power of two # of channels.\n" <<
-				"I don't know what Intel was thinking, but trying to address map half a bit is a neat trick that we're not sure how to do"); 
-		abort(); 
+		return;
+	}
+	worker.horizon.store(cycle);
+	if (worker.sleeping.load())
+	{
+		std::lock_guard<std::mutex> lock(worker.lock);
+		worker.wake.notify_one();
 	}
+}
 
-	// only chan is used from this set 
-	unsigned channelNumber,rank,bank,row,col;
-	addressMapping(addr, channelNumber, rank, bank, row, col,allIniReaders); 
+//blocks until the channel has caught up with the front end's clock
+void MultiChannelMemorySystem::waitForChannel(unsigned channelNumber)
+{
+	if (workers.size() == 0)
+	{
+		return;
+	}
+	ChannelWorker &worker = *workers[channelNumber];
+	if (worker.horizon.load(std::memory_order_relaxed) > currentClockCycle)
+	{
+		ERROR("Channel "<<channelNumber<<" is accessed at cycle "<<currentClockCycle<<" but was promised nothing before cycle "<<worker.horizon);
+		abort();
+	}
+	while (worker.progress.load(std::memory_order_acquire) != currentClockCycle)
+	{
+		std::this_thread::yield();
+	}
+	worker.observed = true;
+}
+
+void MultiChannelMemorySystem::stopParallel()
+{
+	for (size_t i=0; i<workers.size(); i++)
+	{
+		std::lock_guard<std::mutex> lock(workers[i]->lock);
+		workers[i]->stop = true;
+		workers[i]->wake.notify_one();
+	}
+	for (size_t i=0; i<workers.size(); i++)
+	{
+		workers[i]->thread.join();
+		delete workers[i];
+	}
+	workers.clear();
+}
+
+//output of the very first cycle; the parallel mode has it done before the
+//  workers start so that the channels don't print over each other
+void MultiChannelMemorySystem::firstCycleOutput(unsigned channelNumber)
+{
+	if (channelNumber == 0)
+	{
+		InitOutputFiles(traceFilename);
+	}
+	//all channels of a type run at the same clock
+	unsigned systemType = allIniReaders[channelNumber]->SystemType;
+	if (tierIniReader(systemType) == allIniReaders[channelNumber])
+	{
+		DEBUG("HRAMSim1("<<(systemType == TYPE_DRAM ? "DRAM" : "NVM")<<") Clock Frequency ="<<clockDomainCrossers[channelNumber]->clock1<<"Hz, CPU Clock Frequency="<<clockDomainCrossers[channelNumber]->clock2<<"Hz"); 
+	}
+}
+unsigned MultiChannelMemorySystem::findChannelNumber(uint64_t addr)
+{
+	// only chan is used from this set; the channel counts of each memory type
+	// were checked to be powers of two when the channels were set up
+	DecodedAddress decoded;
+	addressMapping->decode(addr, decoded);
+	unsigned channelNumber = decoded.channel;
 	if (channelNumber >= NUM_CHANS)
 	{
 		ERROR("Got channel index "<<channelNumber<<" but only "<<NUM_CHANS<<" exist"); 
@@ -525,25 +815,47 @@ unsigned MultiChannelMemorySystem::findChannelNumber(uint64_t addr)
 
 	return channelNumber;
 }
+const AddressMapping &MultiChannelMemorySystem::getAddressMapping() const
+{
+	return *addressMapping;
+}
 ostream &MultiChannelMemorySystem::getLogFile()
 {
 	return dramsim_log; 
 }
 bool MultiChannelMemorySystem::addTransaction(const Transaction &trans)
 {
-	// copy the transaction and send the pointer to the new transaction 
-	return addTransaction(new Transaction(trans)); 
+	return addTransaction(trans, trans.mapped ? trans.channel : findChannelNumber(trans.address)); 
 }
 
-bool MultiChannelMemorySystem::addTransaction(Transaction *trans)
+//for callers that have already mapped the transaction to a channel; the
+//  channel keeps a copy of trans from its own pool if it accepts it
+bool MultiChannelMemorySystem::addTransaction(const Transaction &trans, unsigned channelNumber)
 {
-	unsigned channelNumber = findChannelNumber(trans->address); 
+	waitForChannel(channelNumber);
 	return channels[channelNumber]->addTransaction(trans); 
 }
 
+bool MultiChannelMemorySystem::addTransaction(Transaction *trans)
+{
+	return addTransaction(trans, trans->mapped ? trans->channel : findChannelNumber(trans->address)); 
+}
+
+//trans is deleted once the memory system has accepted it, as before
+bool MultiChannelMemorySystem::addTransaction(Transaction *trans, unsigned channelNumber)
+{
+	if (!addTransaction(*trans, channelNumber))
+	{
+		return false;
+	}
+	delete trans;
+	return true;
+}
+
 bool MultiChannelMemorySystem::addTransaction(bool isWrite, uint64_t addr)
 {
 	unsigned channelNumber = findChannelNumber(addr); 
+	waitForChannel(channelNumber);
 	return channels[channelNumber]->addTransaction(isWrite, addr); 
 }
 
@@ -558,14 +870,22 @@ bool MultiChannelMemorySystem::addTransaction(bool isWrite, uint64_t addr)
 
 bool MultiChannelMemorySystem::willAcceptTransaction(uint64_t addr)
 {
-	unsigned chan, rank,bank,row,col; 
-	addressMapping(addr, chan, rank, bank, row, col,allIniReaders); 
+	unsigned chan = findChannelNumber(addr);
+	waitForChannel(chan);
 	return channels[chan]->WillAcceptTransaction(); 
 }
 
+//for callers that have already mapped the transaction to a channel
+bool MultiChannelMemorySystem::channelWillAcceptTransaction(unsigned channelNumber, TransactionType type)
+{
+	waitForChannel(channelNumber);
+	return channels[channelNumber]->WillAcceptTransaction(type);
+}
+
 bool MultiChannelMemorySystem::willAcceptTransaction()
 {
 	for (size_t c=0; c<NUM_CHANS; c++) {
+		waitForChannel(c);
 		if (!channels[c]->WillAcceptTransaction())
 		{
 			return false; 
@@ -580,6 +900,7 @@ void MultiChannelMemorySystem::printStats(bool finalStats) {
 
 	for (size_t i=0; i<NUM_CHANS; i++)
 	{
+		waitForChannel(i);
 		PRINT("==== Channel ["<<i<<"] ====");
 	 // (*csvOut) << "ms" <<currentClockCycle * allIniReaders[i]->tCK * 1E-6; 
 		channels[i]->printStats(finalStats); 
@@ -592,6 +913,12 @@ void MultiChannelMemorySystem::RegisterCallbacks(
 		TransactionCompleteCB *writeDone,
 		void (*reportPower)(double bgpower, double burstpower, double refreshpower, double actprepower))
 {
+	if (workers.size() > 0)
+	{
+		ERROR("Callbacks have to be registered before the channels are put on their own threads");
+		abort();
+	}
+	callbacksRegistered = readDone != NULL || writeDone != NULL;
 	for (size_t i=0; i<NUM_CHANS; i++)
 	{
 		channels[i]->RegisterCallbacks(readDone, writeDone, reportPower); 
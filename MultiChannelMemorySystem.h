@@ -34,6 +34,10 @@
 #include "IniReader.h"
 #include "ClockDomain.h"
 #include "CSVWriter.h"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 
 namespace DRAMSim {
@@ -60,9 +64,15 @@ class MultiChannelMemorySystem : public SimulatorObject
 			bool addTransaction(Transaction *trans);
 			bool addTransaction(const Transaction &trans);
 			bool addTransaction(bool isWrite, uint64_t addr);
+			bool addTransaction(Transaction *trans, unsigned channelNumber);
+			bool addTransaction(const Transaction &trans, unsigned channelNumber);
 			bool willAcceptTransaction(); 
 			bool willAcceptTransaction(uint64_t addr); 
+			bool channelWillAcceptTransaction(unsigned channelNumber, TransactionType type);
 			void update();
+			uint64_t fastForward(uint64_t maxCycles);
+			bool startParallel(bool fastForward);
+			void setHorizon(unsigned channelNumber, uint64_t cycle);
 			void printStats(bool finalStats=false);
 			ostream &getLogFile();
 			void RegisterCallbacks( 
@@ -77,8 +87,11 @@ class MultiChannelMemorySystem : public SimulatorObject
 	std::ofstream visDataOut;
 	ofstream dramsim_log; 
 
+	//safe to call from another thread, they only read the configuration
+	unsigned findChannelNumber(uint64_t addr);
+	const AddressMapping &getAddressMapping() const;
+
 	private:
-		unsigned findChannelNumber(uint64_t addr);
 		unsigned megsOfMemory; 
 		unsigned megsOfMemoryPcm; 
     string debugIniFilename;
@@ -91,15 +104,49 @@ class MultiChannelMemorySystem : public SimulatorObject
 		string *visFilename;
 		static void mkdirIfNotExist(string path);
 		static bool fileExists(string path); 
+		//the DRAM channels first, then the NVM ones
 		vector<MemorySystem*> channels; 
     vector<IniReader *> allIniReaders;
+		AddressMapping *addressMapping;
 		vector<string> deviceIniFilenames;
 		vector<string> deviceIniFilenamesPcm;
-    ClockDomain::ClockDomainCrosser clockDomainCrosser; 
-		ClockDomain::ClockDomainCrosser clockDomainCrosserPcm; 
+		//one per channel, each drives the update() of its MemorySystem
+		vector<ClockDomain::ClockDomainCrosser *> clockDomainCrossers;
 		CSVWriter *csvOut; 
-		void actual_update(); 
-		void actual_update_pcm(); 
+		IniReader *loadIniReader(unsigned systemType, unsigned megsOfStorage);
+		IniReader *tierIniReader(unsigned systemType);
+
+		//cpu cycles each channel has been updated for, owned by whichever
+		//  thread updates the channel
+		vector<uint64_t> channelCycles;
+		void updateChannel(unsigned channelNumber);
+		uint64_t channelQuietCycles(unsigned channelNumber, uint64_t maxCycles);
+		void skipChannel(unsigned channelNumber, uint64_t cycles);
+		void firstCycleOutput(unsigned channelNumber);
+
+		//parallel mode: each channel is updated by a worker thread of its own.
+		//  progress is how many update() calls the channel has caught up with and
+		//  horizon how many it may run; only the front end raises the horizon.
+		struct ChannelWorker
+		{
+			std::thread thread;
+			std::atomic<uint64_t> horizon;
+			std::atomic<uint64_t> progress;
+			std::atomic<bool> sleeping;
+			std::atomic<bool> stop;
+			std::mutex lock;
+			std::condition_variable wake;
+			//set when the front end waits for the channel, cleared by update()
+			bool observed;
+		};
+		vector<ChannelWorker *> workers;
+		bool parallelFastForward;
+		bool callbacksRegistered;
+		void runWorker(unsigned channelNumber);
+		bool waitForHorizon(ChannelWorker &worker, uint64_t cycle);
+		void grant(unsigned channelNumber, uint64_t cycle);
+		void waitForChannel(unsigned channelNumber);
+		void stopParallel();
 
 	};
 }
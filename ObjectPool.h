@@ -0,0 +1,171 @@
+/*********************************************************************************
+*  Copyright (c) 2010-2011, Elliott Cooper-Balis
+*                             Paul Rosenfeld
+*                             Bruce Jacob
+*                             University of Maryland 
+*                             dramninjas [at] gmail [dot] com
+*  All rights reserved.
+*  
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions are met:
+*  
+*     * Redistributions of source code must retain the above copyright notice,
+*        this list of conditions and the following disclaimer.
+*  
+*     * Redistributions in binary form must reproduce the above copyright notice,
+*        this list of conditions and the following disclaimer in the documentation
+*        and/or other materials provided with the distribution.
+*  
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+*  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+*  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+*  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+*  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#ifndef OBJECTPOOL_H
+#define OBJECTPOOL_H
+
+//ObjectPool.h
+//
+//Free-list pool that recycles the bus packets and transactions of a channel
+//
+
+#include <stdint.h>
+#include <vector>
+#include <type_traits>
+#include "SystemConfiguration.h"
+
+//objects are carved out of the heap this many at a time
+#define OBJECT_POOL_SLAB_SIZE 256
+
+namespace DRAMSim
+{
+//Hands out storage for objects of type T from slabs and keeps released
+//  objects on a free list, so once the pool has grown to the number of
+//  objects in flight the simulation no longer goes through malloc/free.
+//  Objects are built in place and handed back instead of deleted:
+//
+//		BusPacket *p = new (pool.allocate()) BusPacket(...);
+//		pool.release(p);
+//
+//  A pool belongs to one channel and is only used by the thread updating
+//  that channel, so it takes no locks.
+//
+//  Building with -DPOOL_DEBUG (make DEBUG=1) tags every slot with its pool
+//  and whether it is in use; releasing an object twice or into a pool it
+//  didn't come from aborts, and objects that are still in use when the pool
+//  is destroyed are reported as leaks.
+template <typename T>
+class ObjectPool
+{
+public:
+	ObjectPool(const char *name_) :
+		name(name_),
+		freeList(NULL),
+		inUse(0)
+	{}
+
+	~ObjectPool()
+	{
+#ifdef POOL_DEBUG
+		if (inUse != 0)
+		{
+			ERROR("== Error - "<<inUse<<" "<<name<<" objects were never released");
+		}
+#endif
+		for (size_t i=0; i<slabs.size(); i++)
+		{
+			delete [] slabs[i];
+		}
+	}
+
+	//uninitialized storage for one T
+	void *allocate()
+	{
+		if (freeList == NULL)
+		{
+			grow();
+		}
+		Slot *slot = freeList;
+		freeList = slot->next;
+#ifdef POOL_DEBUG
+		slot->inUse = true;
+#endif
+		inUse++;
+		return &slot->storage;
+	}
+
+	//destroys an object built in storage from allocate(), NULL is ignored
+	void release(T *object)
+	{
+		if (object == NULL)
+		{
+			return;
+		}
+		Slot *slot = reinterpret_cast<Slot *>(object);
+#ifdef POOL_DEBUG
+		if (slot->pool != this)
+		{
+			ERROR("== Error - Releasing a "<<name<<" that wasn't allocated from this pool");
+			abort();
+		}
+		if (!slot->inUse)
+		{
+			ERROR("== Error - Releasing a "<<name<<" twice");
+			abort();
+		}
+		slot->inUse = false;
+#endif
+		object->~T();
+		slot->next = freeList;
+		freeList = slot;
+		inUse--;
+	}
+
+	//objects handed out and not released yet
+	uint64_t getInUse() const
+	{
+		return inUse;
+	}
+
+private:
+	//storage has to come first so that a T* is also a Slot*
+	struct Slot
+	{
+		typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type storage;
+		Slot *next;
+#ifdef POOL_DEBUG
+		ObjectPool *pool;
+		bool inUse;
+#endif
+	};
+
+	void grow()
+	{
+		Slot *slab = new Slot[OBJECT_POOL_SLAB_SIZE];
+		slabs.push_back(slab);
+		for (size_t i=0; i<OBJECT_POOL_SLAB_SIZE; i++)
+		{
+#ifdef POOL_DEBUG
+			slab[i].pool = this;
+			slab[i].inUse = false;
+#endif
+			slab[i].next = freeList;
+			freeList = &slab[i];
+		}
+	}
+
+	const char *name;
+	std::vector<Slot *> slabs;
+	Slot *freeList;
+	uint64_t inUse;
+};
+}
+
+#endif
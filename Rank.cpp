@@ -37,14 +37,22 @@
 using namespace std;
 using namespace DRAMSim;
 
-Rank::Rank(ostream &dramsim_log_, IniReader * iniReader_) :
+Rank::Rank(ostream &dramsim_log_, IniReader * iniReader_, ObjectPool<BusPacket> &busPacketPool_) :
 	id(-1),
 	dramsim_log(dramsim_log_),
+	busPacketPool(busPacketPool_),
 	isPowerDown(false),
 	refreshWaiting(false),
-	readReturnCountdown(0),
+	readReturnPacket(iniReader_->NUM_BANKS),
+	readReturnReady(iniReader_->NUM_BANKS),
 	banks(iniReader_->NUM_BANKS, Bank(dramsim_log_,iniReader_)),
-	bankStates(iniReader_->NUM_BANKS, BankState(dramsim_log_)),
+#ifdef VALIDATE_COMMANDS
+	bankStateTable(1, iniReader_->NUM_BANKS),
+	bankStates(bankStateTable[0]),
+	arrayWriteStart(iniReader_->NUM_BANKS, 0),
+	arrayWriteEnd(iniReader_->NUM_BANKS, 0),
+	pausedArrayWrite(iniReader_->NUM_BANKS, 0),
+#endif
   iniReader(iniReader_)
 
 {
@@ -73,25 +81,89 @@ void Rank::attachMemoryController(MemoryController *memoryController)
 }
 Rank::~Rank()
 {
-	for (size_t i=0; i<readReturnPacket.size(); i++)
+	while (!readReturnPacket.empty())
 	{
-		delete readReturnPacket[i];
+		busPacketPool.release(readReturnPacket.front());
+		readReturnPacket.pop_front();
 	}
-	readReturnPacket.clear(); 
-	delete outgoingDataPacket; 
+	busPacketPool.release(outgoingDataPacket); 
 }
 void Rank::receiveFromBus(BusPacket *packet)
 {
 	if (DEBUG_BUS)
 	{
 		PRINTN(" -- R" << this->id << " Receiving On Bus    : ");
-		packet->print();
+		packet->print(dramsim_log);
 	}
 	if (VERIFICATION_OUTPUT)
 	{
 		packet->print(currentClockCycle,false);
 	}
+#ifdef VALIDATE_COMMANDS
+	validateCommand(packet);
+#endif
+
+	switch (packet->busPacketType)
+	{
+	case READ:
+	case READ_P:
+		//get the read data and put it in the storage which delays until the appropriate time (RL)
+#ifndef NO_STORAGE
+		banks[packet->bank].read(packet);
+#else
+		packet->busPacketType = DATA;
+#endif
+		readReturnPacket.push_back(packet);
+		readReturnReady.push_back(currentClockCycle + iniReader->RL);
+		break;
+	case WRITE:
+	case WRITE_P:
+		//take note of where data is going when it arrives
+		incomingWriteBank = packet->bank;
+		incomingWriteRow = packet->row;
+		incomingWriteColumn = packet->column;
+		busPacketPool.release(packet);
+		break;
+	case ACTIVATE:
+	case PRECHARGE:
+		busPacketPool.release(packet); 
+		break;
+	case REFRESH:
+		refreshWaiting = false;
+		busPacketPool.release(packet); 
+		break;
+	case DATA:
+		// TODO: replace this check with something that works?
+		/*
+		if(packet->bank != incomingWriteBank ||
+			 packet->row != incomingWriteRow ||
+			 packet->column != incomingWriteColumn)
+			{
+				cout << "== Error - Rank " << id << " received a DATA packet to the wrong place" << endl;
+				packet->print(dramsim_log);
+				bankStates[packet->bank].print(dramsim_log);
+				exit(0);
+			}
+		*/
+#ifndef NO_STORAGE
+		banks[packet->bank].write(packet);
+#else
+		// end of the line for the write packet
+#endif
+		busPacketPool.release(packet);
+		break;
+	default:
+		ERROR("== Error - Unknown BusPacketType trying to be sent to Bank");
+		exit(0);
+		break;
+	}
+}
 
+#ifdef VALIDATE_COMMANDS
+//checks a command against the rank's own copy of the timing state, which is
+//  kept apart from the controller's so that a scheduling bug can't hide itself
+void Rank::validateCommand(BusPacket *packet)
+{
 	switch (packet->busPacketType)
 	{
 	case READ:
@@ -100,34 +172,22 @@ void Rank::receiveFromBus(BusPacket *packet)
 		        currentClockCycle < bankStates[packet->bank].nextRead ||
 		        packet->row != bankStates[packet->bank].openRowAddress)
 		{
-			packet->print();
+			packet->print(dramsim_log);
 			ERROR("== Error - Rank " << id << " received a READ when not allowed");
 			exit(0);
 		}
 
 		//update state table
 		bankStates[packet->bank].nextPrecharge = max(bankStates[packet->bank].nextPrecharge, currentClockCycle + READ_TO_PRE_DELAY);
-		for (size_t i=0;i<iniReader->NUM_BANKS;i++)
-		{
-			bankStates[i].nextRead = max(bankStates[i].nextRead, currentClockCycle + max(iniReader->tCCD, iniReader->BL/2));
-			bankStates[i].nextWrite = max(bankStates[i].nextWrite, currentClockCycle + READ_TO_WRITE_DELAY);
-		}
+		bankStateTable.delayColumnAccesses(0, currentClockCycle + max(iniReader->tCCD, iniReader->BL/2),
+				currentClockCycle + READ_TO_WRITE_DELAY);
 
 		if(iniReader->SystemType == TYPE_NVM && iniReader->rowBufferPolicy == ClosePage)
 		{
 			bankStates[packet->bank].currentBankState = Idle;
 			bankStates[packet->bank].nextActivate = iniReader->AL+iniReader->tRTP;
 		}
-		
-
-		//get the read data and put it in the storage which delays until the appropriate time (RL)
-#ifndef NO_STORAGE
-		banks[packet->bank].read(packet);
-#else
-		packet->busPacketType = DATA;
-#endif
-		readReturnPacket.push_back(packet);
-		readReturnCountdown.push_back(iniReader->RL);
+		resumeArrayWrite(packet->bank);
 		break;
 	case READ_P:
 		//make sure a read is allowed
@@ -142,22 +202,10 @@ void Rank::receiveFromBus(BusPacket *packet)
 		//update state table
 		bankStates[packet->bank].currentBankState = Idle;
 		bankStates[packet->bank].nextActivate = max(bankStates[packet->bank].nextActivate, currentClockCycle + READ_AUTOPRE_DELAY);
-		for (size_t i=0;i<iniReader->NUM_BANKS;i++)
-		{
-			//will set next read/write for all banks - including current (which shouldnt matter since its now idle)
-			bankStates[i].nextRead = max(bankStates[i].nextRead, currentClockCycle + max(iniReader->BL/2, iniReader->tCCD));
-			bankStates[i].nextWrite = max(bankStates[i].nextWrite, currentClockCycle + READ_TO_WRITE_DELAY);
-		}
-
-		//get the read data and put it in the storage which delays until the appropriate time (RL)
-#ifndef NO_STORAGE
-		banks[packet->bank].read(packet);
-#else
-		packet->busPacketType = DATA;
-#endif
-
-		readReturnPacket.push_back(packet);
-		readReturnCountdown.push_back(iniReader->RL);
+		//will set next read/write for all banks - including current (which shouldnt matter since its now idle)
+		bankStateTable.delayColumnAccesses(0, currentClockCycle + max(iniReader->BL/2, iniReader->tCCD),
+				currentClockCycle + READ_TO_WRITE_DELAY);
+		resumeArrayWrite(packet->bank);
 		break;
 	case WRITE:
 		//make sure a write is allowed
@@ -166,23 +214,14 @@ void Rank::receiveFromBus(BusPacket *packet)
 		        packet->row != bankStates[packet->bank].openRowAddress)
 		{
 			ERROR("== Error - Rank " << id << " received a WRITE when not allowed");
-			bankStates[packet->bank].print();
+			bankStates[packet->bank].print(dramsim_log);
 			exit(0);
 		}
 
 		//update state table
 		bankStates[packet->bank].nextPrecharge = max(bankStates[packet->bank].nextPrecharge, currentClockCycle + WRITE_TO_PRE_DELAY);
-		for (size_t i=0;i<iniReader->NUM_BANKS;i++)
-		{
-			bankStates[i].nextRead = max(bankStates[i].nextRead, currentClockCycle + WRITE_TO_READ_DELAY_B);
-			bankStates[i].nextWrite = max(bankStates[i].nextWrite, currentClockCycle + max(iniReader->BL/2, iniReader->tCCD));
-		}
-
-		//take note of where data is going when it arrives
-		incomingWriteBank = packet->bank;
-		incomingWriteRow = packet->row;
-		incomingWriteColumn = packet->column;
-		delete(packet);
+		bankStateTable.delayColumnAccesses(0, currentClockCycle + WRITE_TO_READ_DELAY_B,
+				currentClockCycle + max(iniReader->BL/2, iniReader->tCCD));
 		break;
 	case WRITE_P:
 		//make sure a write is allowed
@@ -194,29 +233,40 @@ void Rank::receiveFromBus(BusPacket *packet)
 			exit(0);
 		}
 
-		//update state table
+		//update state table; the rank doesn't know how many iterations the
+		//  controller drew for the array write, so it allows for the fewest
 		bankStates[packet->bank].currentBankState = Idle;
-		bankStates[packet->bank].nextActivate = max(bankStates[packet->bank].nextActivate, currentClockCycle + WRITE_AUTOPRE_DELAY);
-		for (size_t i=0;i<iniReader->NUM_BANKS;i++)
+		bankStates[packet->bank].nextActivate = max(bankStates[packet->bank].nextActivate,
+		        currentClockCycle + WRITE_TO_PRE_DELAY + ARRAY_WRITE_TIME(iniReader->minWriteIterations));
+		bankStateTable.delayColumnAccesses(0, currentClockCycle + WRITE_TO_READ_DELAY_B,
+				currentClockCycle + max(iniReader->tCCD, iniReader->BL/2));
+		if (WRITES_INTERRUPTIBLE)
 		{
-			bankStates[i].nextWrite = max(bankStates[i].nextWrite, currentClockCycle + max(iniReader->tCCD, iniReader->BL/2));
-			bankStates[i].nextRead = max(bankStates[i].nextRead, currentClockCycle + WRITE_TO_READ_DELAY_B);
+			//a write paused in the bank goes on once this one is done
+			arrayWriteStart[packet->bank] = currentClockCycle + WRITE_TO_PRE_DELAY;
+			arrayWriteEnd[packet->bank] = arrayWriteStart[packet->bank] + ARRAY_WRITE_TIME(iniReader->WRITE_ITERATIONS);
+			if (pausedArrayWrite[packet->bank] > 0)
+			{
+				arrayWriteEnd[packet->bank] += ARRAY_WRITE_TIME(iniReader->WRITE_ITERATIONS);
+			}
+			pausedArrayWrite[packet->bank] = 0;
 		}
-
-		//take note of where data is going when it arrives
-		incomingWriteBank = packet->bank;
-		incomingWriteRow = packet->row;
-		incomingWriteColumn = packet->column;
-		delete(packet);
 		break;
 	case ACTIVATE:
+	{
+		//an activate may cut into an array write, to pause it no sooner than
+		//  the first step boundary
+		bool interrupts = WRITES_INTERRUPTIBLE && currentClockCycle < bankStates[packet->bank].nextActivate &&
+		        currentClockCycle >= arrayWriteStart[packet->bank] && currentClockCycle < arrayWriteEnd[packet->bank] &&
+		        (iniReader->WRITE_CANCEL_THRESHOLD > 0 ||
+		         currentClockCycle >= arrayWriteStart[packet->bank] + ARRAY_WRITE_TIME(1));
 		//make sure activate is allowed
 		if (bankStates[packet->bank].currentBankState != Idle ||
-		        currentClockCycle < bankStates[packet->bank].nextActivate)
+		        (currentClockCycle < bankStates[packet->bank].nextActivate && !interrupts))
 		{
 			ERROR("== Error - Rank " << id << " received an ACT when not allowed");
-			packet->print();
-			bankStates[packet->bank].print();
+			packet->print(dramsim_log);
+			bankStates[packet->bank].print(dramsim_log);
 			exit(0);
 		}
 
@@ -237,15 +287,17 @@ void Rank::receiveFromBus(BusPacket *packet)
 		}
 
 		bankStates[packet->bank].nextPrecharge = currentClockCycle + iniReader->tRAS;
-		for (size_t i=0;i<iniReader->NUM_BANKS;i++)
+		bankStateTable.delayActivates(0, packet->bank, currentClockCycle + iniReader->tRRD);
+
+		if (interrupts)
 		{
-			if (i != packet->bank)
-			{
-				bankStates[i].nextActivate = max(bankStates[i].nextActivate, currentClockCycle + iniReader->tRRD);
-			}
+			//a cancelled write leaves nothing to go on with
+			pausedArrayWrite[packet->bank] = iniReader->WRITE_CANCEL_THRESHOLD > 0 ? 0 :
+			        currentClockCycle - arrayWriteStart[packet->bank];
+			arrayWriteEnd[packet->bank] = 0;
 		}
-		delete(packet); 
 		break;
+	}
 	case PRECHARGE:
 		//make sure precharge is allowed
 		if (bankStates[packet->bank].currentBankState != RowActive ||
@@ -257,10 +309,8 @@ void Rank::receiveFromBus(BusPacket *packet)
 
 		bankStates[packet->bank].currentBankState = Idle;
 		bankStates[packet->bank].nextActivate = max(bankStates[packet->bank].nextActivate, currentClockCycle + iniReader->tRP);
-		delete(packet); 
 		break;
 	case REFRESH:
-		refreshWaiting = false;
 		for (size_t i=0;i<iniReader->NUM_BANKS;i++)
 		{
 			if (bankStates[i].currentBankState != Idle)
@@ -270,35 +320,28 @@ void Rank::receiveFromBus(BusPacket *packet)
 			}
 			bankStates[i].nextActivate = currentClockCycle + iniReader->tRFC;
 		}
-		delete(packet); 
-		break;
-	case DATA:
-		// TODO: replace this check with something that works?
-		/*
-		if(packet->bank != incomingWriteBank ||
-			 packet->row != incomingWriteRow ||
-			 packet->column != incomingWriteColumn)
-			{
-				cout << "== Error - Rank " << id << " received a DATA packet to the wrong place" << endl;
-				packet->print();
-				bankStates[packet->bank].print();
-				exit(0);
-			}
-		*/
-#ifndef NO_STORAGE
-		banks[packet->bank].write(packet);
-#else
-		// end of the line for the write packet
-#endif
-		delete(packet);
 		break;
 	default:
-		ERROR("== Error - Unknown BusPacketType trying to be sent to Bank");
-		exit(0);
 		break;
 	}
 }
 
+//a write paused in the bank goes on from the read that paused it, which is
+//  no later than the controller has it go on
+void Rank::resumeArrayWrite(unsigned bank)
+{
+	if (pausedArrayWrite[bank] == 0)
+	{
+		return;
+	}
+	arrayWriteStart[bank] = currentClockCycle - pausedArrayWrite[bank];
+	arrayWriteEnd[bank] = arrayWriteStart[bank] + ARRAY_WRITE_TIME(iniReader->WRITE_ITERATIONS);
+	bankStates[bank].nextActivate = max(bankStates[bank].nextActivate,
+	        arrayWriteStart[bank] + ARRAY_WRITE_TIME(iniReader->minWriteIterations));
+	pausedArrayWrite[bank] = 0;
+}
+#endif
+
 int Rank::getId() const
 {
 	return this->id;
@@ -320,38 +363,60 @@ void Rank::update()
 		}
 	}
 
-	// decrement the counter for all packets waiting to be sent back
-	for (size_t i=0;i<readReturnCountdown.size();i++)
-	{
-		readReturnCountdown[i]--;
-	}
-
-
-	if (readReturnCountdown.size() > 0 && readReturnCountdown[0]==0)
+	// the packets waiting to be sent back are due in the order they were read
+	if (readReturnReady.size() > 0 && readReturnReady.front()==currentClockCycle)
 	{
 		// RL time has passed since the read was issued; this packet is
 		// ready to go out on the bus
 
-		outgoingDataPacket = readReturnPacket[0];
+		outgoingDataPacket = readReturnPacket.front();
 		dataCyclesLeft = iniReader->BL/2;
 
 		// remove the packet from the ranks
-		readReturnPacket.erase(readReturnPacket.begin());
-		readReturnCountdown.erase(readReturnCountdown.begin());
+		readReturnPacket.pop_front();
+		readReturnReady.pop_front();
 
 		if (DEBUG_BUS)
 		{
 			PRINTN(" -- R" << this->id << " Issuing On Data Bus : ");
-			outgoingDataPacket->print();
+			outgoingDataPacket->print(dramsim_log);
 			PRINT("");
 		}
 
 	}
 }
 
+//the data bus and the head of the read return queue are the only things
+//  update() acts on; everything else happens when a command arrives
+uint64_t Rank::nextEventCycle()
+{
+	uint64_t next = UINT64_MAX;
+	if (outgoingDataPacket != NULL)
+	{
+		next = currentClockCycle + dataCyclesLeft - 1;
+	}
+	if (readReturnReady.size() > 0)
+	{
+		next = min(next, readReturnReady.front());
+	}
+	return next;
+}
+
+//does the work of that many update() calls at once; currentClockCycle+cycles
+//  must not exceed nextEventCycle()
+void Rank::fastForward(uint64_t cycles)
+{
+	if (outgoingDataPacket != NULL)
+	{
+		dataCyclesLeft -= cycles;
+	}
+	currentClockCycle += cycles;
+}
+
 //power down the rank
 void Rank::powerDown()
 {
+#ifdef VALIDATE_COMMANDS
 	//perform checks
 	for (size_t i=0;i<iniReader->NUM_BANKS;i++)
 	{
@@ -364,6 +429,7 @@ void Rank::powerDown()
 		bankStates[i].nextPowerUp = currentClockCycle + iniReader->tCKE;
 		bankStates[i].currentBankState = PowerDown;
 	}
+#endif
 
 	isPowerDown = true;
 }
@@ -379,6 +445,7 @@ void Rank::powerUp()
 
 	isPowerDown = false;
 
+#ifdef VALIDATE_COMMANDS
 	for (size_t i=0;i<iniReader->NUM_BANKS;i++)
 	{
 		if (bankStates[i].nextPowerUp > currentClockCycle)
@@ -390,4 +457,5 @@ void Rank::powerUp()
 		bankStates[i].nextActivate = currentClockCycle + iniReader->tXP;
 		bankStates[i].currentBankState = Idle;
 	}
+#endif
 }
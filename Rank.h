@@ -40,6 +40,8 @@
 #include "Bank.h"
 #include "BankState.h"
 #include "IniReader.h"
+#include "ObjectPool.h"
+#include "RingBuffer.h"
 
 using namespace std;
 using namespace DRAMSim;
@@ -52,6 +54,8 @@ class Rank : public SimulatorObject
 private:
 	int id;
 	ostream &dramsim_log; 
+	//the channel's packets, received commands and data end up back in here
+	ObjectPool<BusPacket> &busPacketPool;
 	unsigned incomingWriteBank;
 	unsigned incomingWriteRow;
 	unsigned incomingWriteColumn;
@@ -59,7 +63,7 @@ private:
 
 public:
 	//functions
-	Rank(ostream &dramsim_log_,IniReader * iniReader);
+	Rank(ostream &dramsim_log_,IniReader * iniReader, ObjectPool<BusPacket> &busPacketPool_);
 	virtual ~Rank(); 
 	void receiveFromBus(BusPacket *packet);
 	void attachMemoryController(MemoryController *mc);
@@ -68,6 +72,13 @@ public:
 	void update();
 	void powerUp();
 	void powerDown();
+#ifdef VALIDATE_COMMANDS
+	void validateCommand(BusPacket *packet);
+	void resumeArrayWrite(unsigned bank);
+#endif
+	//first cycle at which update() will do more than count down
+	uint64_t nextEventCycle();
+	void fastForward(uint64_t cycles);
 
 	//fields
 	MemoryController *memoryController;
@@ -76,10 +87,23 @@ public:
 	bool refreshWaiting;
 
 	//these are vectors so that each element is per-bank
-	vector<BusPacket *> readReturnPacket;
-	vector<unsigned> readReturnCountdown;
+	RingBuffer<BusPacket *> readReturnPacket;
+	//cycle at which each packet of readReturnPacket goes on the data bus
+	RingBuffer<uint64_t> readReturnReady;
 	vector<Bank> banks;
-	vector<BankState> bankStates;
+#ifdef VALIDATE_COMMANDS
+	//the rank's own copy of its bank states, which it checks the commands against;
+	//  the scheduling state of the channel lives in MemorySystem::bankStates
+	BankStateTable bankStateTable;
+	BankStateTable::RankView bankStates;
+	//with WRITES_INTERRUPTIBLE, the array write of each bank, which may run
+	//  until the longest write could end, and the cycles a paused one had done;
+	//  the rank can't tell which reads the controller let in to pause and which
+	//  to cancel, nor how long each write is, so these only bound the controller's
+	vector<uint64_t> arrayWriteStart;
+	vector<uint64_t> arrayWriteEnd;
+	vector<unsigned> pausedArrayWrite;
+#endif
   IniReader * iniReader;
 
 };
@@ -0,0 +1,213 @@
+/*********************************************************************************
+*  Copyright (c) 2010-2011, Elliott Cooper-Balis
+*                             Paul Rosenfeld
+*                             Bruce Jacob
+*                             University of Maryland 
+*                             dramninjas [at] gmail [dot] com
+*  All rights reserved.
+*  
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions are met:
+*  
+*     * Redistributions of source code must retain the above copyright notice,
+*        this list of conditions and the following disclaimer.
+*  
+*     * Redistributions in binary form must reproduce the above copyright notice,
+*        this list of conditions and the following disclaimer in the documentation
+*        and/or other materials provided with the distribution.
+*  
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+*  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+*  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+*  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+*  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+//RingBuffer.h
+//
+//FIFO used for the controller and rank queues
+//
+
+#include <stdint.h>
+#include <vector>
+
+namespace DRAMSim
+{
+//Queue over a power-of-two array that never moves its entries, so push_back
+//  and pop_front are O(1) no matter how deep the queue is configured.
+//
+//Every entry is addressed by a handle, the position it was pushed at, which
+//  stays valid until the entry is erased. Erasing an entry from the middle
+//  just leaves a hole that next()/prev() step over and that is reclaimed
+//  once the front or back of the queue reaches it:
+//
+//		for (RingBuffer<T>::Handle h=q.begin(); h!=q.end(); h=q.next(h))
+//			if (pick(q[h])) { q.erase(h); break; }
+//
+//The queue is sized up front by the caller's depth; it only has to grow when
+//  an entry at the front is held up for so long that the holes behind it
+//  fill the whole array.
+template <typename T>
+class RingBuffer
+{
+public:
+	typedef uint64_t Handle;
+
+	RingBuffer(size_t capacity_ = 1) :
+		capacity(1),
+		head(0),
+		tail(0),
+		count(0)
+	{
+		while (capacity < capacity_)
+		{
+			capacity <<= 1;
+		}
+		mask = capacity - 1;
+		slots.resize(capacity);
+		occupied.resize(capacity, false);
+	}
+
+	size_t size() const
+	{
+		return count;
+	}
+	bool empty() const
+	{
+		return count == 0;
+	}
+
+	//makes room for capacity_ entries without growing again
+	void reserve(size_t capacity_)
+	{
+		while (capacity < capacity_)
+		{
+			grow();
+		}
+	}
+
+	//handles of the live entries, oldest first; begin() and the entry before
+	//  end() are always live
+	Handle begin() const
+	{
+		return head;
+	}
+	Handle end() const
+	{
+		return tail;
+	}
+	Handle next(Handle h) const
+	{
+		do
+		{
+			h++;
+		}
+		while (h != tail && !occupied[h & mask]);
+		return h;
+	}
+	//h must not be begin()
+	Handle prev(Handle h) const
+	{
+		do
+		{
+			h--;
+		}
+		while (!occupied[h & mask]);
+		return h;
+	}
+
+	T &operator[](Handle h)
+	{
+		return slots[h & mask];
+	}
+	T &front()
+	{
+		return slots[head & mask];
+	}
+
+	Handle push_back(const T &item)
+	{
+		if (tail - head == capacity)
+		{
+			grow();
+		}
+		slots[tail & mask] = item;
+		occupied[tail & mask] = true;
+		count++;
+		return tail++;
+	}
+
+	void pop_front()
+	{
+		erase(head);
+	}
+
+	void erase(Handle h)
+	{
+		occupied[h & mask] = false;
+		count--;
+		//pull the ends in over any holes so they stay on live entries
+		if (h == head)
+		{
+			while (head != tail && !occupied[head & mask])
+			{
+				head++;
+			}
+		}
+		else if (h == tail - 1)
+		{
+			while (!occupied[(tail - 1) & mask])
+			{
+				tail--;
+			}
+		}
+	}
+
+	void clear()
+	{
+		for (Handle h=head; h!=tail; h++)
+		{
+			occupied[h & mask] = false;
+		}
+		head = tail;
+		count = 0;
+	}
+
+private:
+	//doubles the array; entries keep their handles
+	void grow()
+	{
+		size_t newCapacity = capacity << 1;
+		size_t newMask = newCapacity - 1;
+		std::vector<T> newSlots(newCapacity);
+		std::vector<bool> newOccupied(newCapacity, false);
+		for (Handle h=head; h!=tail; h++)
+		{
+			newSlots[h & newMask] = slots[h & mask];
+			newOccupied[h & newMask] = occupied[h & mask];
+		}
+		slots.swap(newSlots);
+		occupied.swap(newOccupied);
+		capacity = newCapacity;
+		mask = newMask;
+	}
+
+	std::vector<T> slots;
+	std::vector<bool> occupied;
+	size_t capacity;
+	size_t mask;
+	Handle head;
+	Handle tail;
+	size_t count;
+};
+}
+
+#endif
@@ -0,0 +1,161 @@
+/*********************************************************************************
+*  Copyright (c) 2010-2011, Elliott Cooper-Balis
+*                             Paul Rosenfeld
+*                             Bruce Jacob
+*                             University of Maryland 
+*                             dramninjas [at] gmail [dot] com
+*  All rights reserved.
+*  
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions are met:
+*  
+*     * Redistributions of source code must retain the above copyright notice,
+*        this list of conditions and the following disclaimer.
+*  
+*     * Redistributions in binary form must reproduce the above copyright notice,
+*        this list of conditions and the following disclaimer in the documentation
+*        and/or other materials provided with the distribution.
+*  
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+*  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+*  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+*  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+*  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+
+
+
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+//SPSCRing.h
+//
+//Bounded single-producer/single-consumer ring used to hand work between threads
+//
+
+#include <stdint.h>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include "SystemConfiguration.h"
+
+#define SPSC_CACHE_LINE 64
+
+namespace DRAMSim
+{
+//Lock-free as long as exactly one thread pushes and exactly one thread pops.
+//  The producer owns tail and the consumer owns head; each only reads the
+//  other's index, so a single acquire/release pair per operation is enough.
+//  push()/pop() spin (yielding the core) until they can make progress and
+//  count how many operations had to wait, which tells whether the producer
+//  or the consumer is the bottleneck.
+template <typename T>
+class SPSCRing
+{
+public:
+	SPSCRing(size_t capacity_) :
+		head(0),
+		tail(0),
+		pushStalls(0),
+		popStalls(0)
+	{
+		capacity = 1;
+		while (capacity < capacity_)
+		{
+			capacity <<= 1;
+		}
+		mask = capacity - 1;
+		slots.resize(capacity);
+	}
+
+	//non-blocking variants, return false if the ring is full/empty
+	bool tryPush(const T &item)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == capacity)
+		{
+			return false;
+		}
+		slots[t & mask] = item;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool tryPop(T &item)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		item = slots[h & mask];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	//blocking variants; stop lets the caller give up waiting (e.g. on shutdown)
+	bool push(const T &item, const std::atomic<bool> &stop)
+	{
+		if (tryPush(item))
+		{
+			return true;
+		}
+		pushStalls++;
+		while (!tryPush(item))
+		{
+			if (stop.load(std::memory_order_relaxed))
+			{
+				return false;
+			}
+			std::this_thread::yield();
+		}
+		return true;
+	}
+
+	void pop(T &item)
+	{
+		if (tryPop(item))
+		{
+			return;
+		}
+		popStalls++;
+		while (!tryPop(item))
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	uint64_t getPushStalls() const { return pushStalls; }
+	uint64_t getPopStalls() const { return popStalls; }
+
+private:
+	size_t capacity;
+	size_t mask;
+	std::vector<T> slots;
+	//keep the two indices a cache line apart so the threads don't false-share;
+	//  padding rather than alignas, since the ring is heap allocated and C++11
+	//  operator new does not honour extended alignment
+	char padHead[SPSC_CACHE_LINE];
+	std::atomic<size_t> head;
+	char padTail[SPSC_CACHE_LINE - sizeof(std::atomic<size_t>)];
+	std::atomic<size_t> tail;
+	char padStalls[SPSC_CACHE_LINE - sizeof(std::atomic<size_t>)];
+	//only touched by the producer and the consumer respectively
+	uint64_t pushStalls;
+	char padPopStalls[SPSC_CACHE_LINE - sizeof(uint64_t)];
+	uint64_t popStalls;
+	char padEnd[SPSC_CACHE_LINE - sizeof(uint64_t)];
+
+	//disable copy constructor and assignment operator
+	SPSCRing(const SPSCRing &);
+	SPSCRing &operator=(const SPSCRing &);
+};
+}
+
+#endif
@@ -0,0 +1,308 @@
+/*********************************************************************************
+*  Copyright (c) 2010-2011, Elliott Cooper-Balis
+*                             Paul Rosenfeld
+*                             Bruce Jacob
+*                             University of Maryland 
+*                             dramninjas [at] gmail [dot] com
+*  All rights reserved.
+*  
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions are met:
+*  
+*     * Redistributions of source code must retain the above copyright notice,
+*        this list of conditions and the following disclaimer.
+*  
+*     * Redistributions in binary form must reproduce the above copyright notice,
+*        this list of conditions and the following disclaimer in the documentation
+*        and/or other materials provided with the distribution.
+*  
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+*  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+*  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+*  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+*  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+
+
+//Scheduler.cpp
+//
+//Class file for the command scheduling policies
+//
+
+#include "Scheduler.h"
+
+using namespace std;
+
+namespace DRAMSim
+{
+
+Scheduler::Scheduler(IniReader *iniReader_) :
+	iniReader(iniReader_)
+{
+}
+
+Scheduler *Scheduler::create(IniReader *iniReader)
+{
+	switch (iniReader->schedulingPolicy)
+	{
+	case FirstReadyFCFS:
+		return new FirstReadyFCFSScheduler(iniReader);
+	case Atlas:
+		return new AtlasScheduler(iniReader);
+	case Bliss:
+		return new BlissScheduler(iniReader);
+	case ParBS:
+		return new ParBSScheduler(iniReader);
+	default:
+		return NULL;
+	}
+}
+
+size_t Scheduler::choose(const vector<SchedulerCandidate> &candidates, uint64_t cycle)
+{
+	advance(cycle);
+	size_t best = 0;
+	for (size_t i=1; i<candidates.size(); i++)
+	{
+		if (before(candidates[i], candidates[best], cycle))
+		{
+			best = i;
+		}
+	}
+	return best;
+}
+
+bool Scheduler::firstReady(const SchedulerCandidate &a, const SchedulerCandidate &b)
+{
+	if (a.rowHit != b.rowHit)
+	{
+		return a.rowHit;
+	}
+	return a.age < b.age;
+}
+
+bool FirstReadyFCFSScheduler::before(const SchedulerCandidate &a, const SchedulerCandidate &b, uint64_t cycle)
+{
+	return firstReady(a, b);
+}
+
+AtlasScheduler::AtlasScheduler(IniReader *iniReader_) :
+	Scheduler(iniReader_),
+	quantumEnd(ATLAS_QUANTUM),
+	service(1U<<BUSPACKET_SOURCE_BITS, 0),
+	attainedService(1U<<BUSPACKET_SOURCE_BITS, 0.0)
+{
+}
+
+//a source is charged for the cycles its commands keep the bank busy
+void AtlasScheduler::removed(const BusPacket *packet, uint64_t age, bool issued, uint64_t cycle)
+{
+	if (!issued)
+	{
+		return;
+	}
+	advance(cycle);
+	if (packet->busPacketType == ACTIVATE)
+	{
+		service[packet->source] += iniReader->tRCD;
+	}
+	else
+	{
+		service[packet->source] += iniReader->BL/2;
+	}
+}
+
+void AtlasScheduler::advance(uint64_t cycle)
+{
+	while (cycle >= quantumEnd)
+	{
+		for (size_t i=0; i<service.size(); i++)
+		{
+			attainedService[i] = ATLAS_HISTORY_WEIGHT*attainedService[i] + (1.0-ATLAS_HISTORY_WEIGHT)*service[i];
+			service[i] = 0;
+		}
+		quantumEnd += ATLAS_QUANTUM;
+	}
+}
+
+bool AtlasScheduler::before(const SchedulerCandidate &a, const SchedulerCandidate &b, uint64_t cycle)
+{
+	//commands kept waiting too long go first so that nobody starves
+	bool aOverdue = cycle - a.enqueuedAt > ATLAS_AGE_THRESHOLD;
+	bool bOverdue = cycle - b.enqueuedAt > ATLAS_AGE_THRESHOLD;
+	if (aOverdue != bOverdue)
+	{
+		return aOverdue;
+	}
+	double aService = attainedService[a.packet->source];
+	double bService = attainedService[b.packet->source];
+	if (aService != bService)
+	{
+		return aService < bService;
+	}
+	return firstReady(a, b);
+}
+
+BlissScheduler::BlissScheduler(IniReader *iniReader_) :
+	Scheduler(iniReader_),
+	nextClearing(BLISS_CLEARING_INTERVAL),
+	lastSource(0),
+	streak(0),
+	blacklisted(1U<<BUSPACKET_SOURCE_BITS, false)
+{
+}
+
+//counts the column accesses each source gets served in a row
+void BlissScheduler::removed(const BusPacket *packet, uint64_t age, bool issued, uint64_t cycle)
+{
+	if (!issued || packet->busPacketType == ACTIVATE)
+	{
+		return;
+	}
+	advance(cycle);
+	if (streak > 0 && packet->source == lastSource)
+	{
+		streak++;
+		if (streak >= BLISS_STREAK)
+		{
+			blacklisted[packet->source] = true;
+		}
+	}
+	else
+	{
+		lastSource = packet->source;
+		streak = 1;
+	}
+}
+
+void BlissScheduler::advance(uint64_t cycle)
+{
+	if (cycle >= nextClearing)
+	{
+		blacklisted.assign(blacklisted.size(), false);
+		nextClearing = (cycle/BLISS_CLEARING_INTERVAL + 1)*BLISS_CLEARING_INTERVAL;
+	}
+}
+
+bool BlissScheduler::before(const SchedulerCandidate &a, const SchedulerCandidate &b, uint64_t cycle)
+{
+	bool aBlacklisted = blacklisted[a.packet->source];
+	bool bBlacklisted = blacklisted[b.packet->source];
+	if (aBlacklisted != bBlacklisted)
+	{
+		return bBlacklisted;
+	}
+	return firstReady(a, b);
+}
+
+ParBSScheduler::ParBSScheduler(IniReader *iniReader_) :
+	Scheduler(iniReader_),
+	requests(iniReader_->NUM_RANKS*iniReader_->NUM_BANKS),
+	markedLeft(0),
+	maxBankLoad(1U<<BUSPACKET_SOURCE_BITS, 0),
+	totalLoad(1U<<BUSPACKET_SOURCE_BITS, 0)
+{
+}
+
+//a request is tracked by its column access
+void ParBSScheduler::enqueued(const BusPacket *packet, uint64_t age, uint64_t cycle)
+{
+	if (packet->busPacketType != ACTIVATE)
+	{
+		requests[packet->rank*iniReader->NUM_BANKS+packet->bank][packet->source][age] = false;
+	}
+}
+
+void ParBSScheduler::removed(const BusPacket *packet, uint64_t age, bool issued, uint64_t cycle)
+{
+	if (packet->busPacketType == ACTIVATE)
+	{
+		return;
+	}
+	map<unsigned, Requests> &bankRequests = requests[packet->rank*iniReader->NUM_BANKS+packet->bank];
+	Requests &sourceRequests = bankRequests[packet->source];
+	Requests::iterator request = sourceRequests.find(age);
+	if (request->second)
+	{
+		markedLeft--;
+	}
+	sourceRequests.erase(request);
+	if (sourceRequests.empty())
+	{
+		bankRequests.erase(packet->source);
+	}
+}
+
+//forms the next batch once the last one has been served
+void ParBSScheduler::advance(uint64_t cycle)
+{
+	if (markedLeft > 0)
+	{
+		return;
+	}
+	maxBankLoad.assign(maxBankLoad.size(), 0);
+	totalLoad.assign(totalLoad.size(), 0);
+	for (size_t i=0; i<requests.size(); i++)
+	{
+		for (map<unsigned, Requests>::iterator source=requests[i].begin(); source!=requests[i].end(); source++)
+		{
+			unsigned marked = 0;
+			for (Requests::iterator r=source->second.begin(); r!=source->second.end() && marked<PARBS_MARKING_CAP; r++)
+			{
+				r->second = true;
+				marked++;
+			}
+			maxBankLoad[source->first] = max(maxBankLoad[source->first], marked);
+			totalLoad[source->first] += marked;
+			markedLeft += marked;
+		}
+	}
+}
+
+bool ParBSScheduler::isMarked(const SchedulerCandidate &c)
+{
+	const BusPacket *packet = c.packet;
+	map<unsigned, Requests> &bankRequests = requests[packet->rank*iniReader->NUM_BANKS+packet->bank];
+	map<unsigned, Requests>::iterator source = bankRequests.find(packet->source);
+	if (source == bankRequests.end())
+	{
+		return false;
+	}
+	//an activate is marked with the column access enqueued right after it
+	Requests::iterator request = source->second.find(c.rowHit ? c.age : c.age+1);
+	return request != source->second.end() && request->second;
+}
+
+bool ParBSScheduler::before(const SchedulerCandidate &a, const SchedulerCandidate &b, uint64_t cycle)
+{
+	bool aMarked = isMarked(a);
+	bool bMarked = isMarked(b);
+	if (aMarked != bMarked)
+	{
+		return aMarked;
+	}
+	if (a.rowHit != b.rowHit)
+	{
+		return a.rowHit;
+	}
+	//shortest job first: the source with the lightest load in the batch
+	unsigned aSource = a.packet->source;
+	unsigned bSource = b.packet->source;
+	if (maxBankLoad[aSource] != maxBankLoad[bSource])
+	{
+		return maxBankLoad[aSource] < maxBankLoad[bSource];
+	}
+	if (totalLoad[aSource] != totalLoad[bSource])
+	{
+		return totalLoad[aSource] < totalLoad[bSource];
+	}
+	return a.age < b.age;
+}
+
+}
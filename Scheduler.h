@@ -0,0 +1,173 @@
+/*********************************************************************************
+*  Copyright (c) 2010-2011, Elliott Cooper-Balis
+*                             Paul Rosenfeld
+*                             Bruce Jacob
+*                             University of Maryland 
+*                             dramninjas [at] gmail [dot] com
+*  All rights reserved.
+*  
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions are met:
+*  
+*     * Redistributions of source code must retain the above copyright notice,
+*        this list of conditions and the following disclaimer.
+*  
+*     * Redistributions in binary form must reproduce the above copyright notice,
+*        this list of conditions and the following disclaimer in the documentation
+*        and/or other materials provided with the distribution.
+*  
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+*  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+*  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+*  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+*  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+//Scheduler.h
+//
+//Header file for the command scheduling policies
+//
+
+#include "BusPacket.h"
+#include "IniReader.h"
+#include <vector>
+#include <map>
+
+//ATLAS: memory cycles per quantum, the weight the service attained in past
+//	quanta keeps, and the cycles after which a waiting command goes first
+#define ATLAS_QUANTUM 1000000
+#define ATLAS_HISTORY_WEIGHT 0.875
+#define ATLAS_AGE_THRESHOLD 100000
+//BLISS: requests served in a row that get a source blacklisted, and the
+//	cycles after which the blacklist is cleared
+#define BLISS_STREAK 4
+#define BLISS_CLEARING_INTERVAL 10000
+//PAR-BS: requests of a source to one bank marked per batch
+#define PARBS_MARKING_CAP 5
+
+namespace DRAMSim
+{
+//A command that meets its timing and may be issued this cycle: either the
+//	oldest access to the row a bank has open, or the oldest activate a source
+//	has queued for a bank with no open row
+struct SchedulerCandidate
+{
+	BusPacket *packet;
+	//order the command was enqueued in across the channel; a request's
+	//	activate is enqueued right before its column access
+	uint64_t age;
+	uint64_t enqueuedAt;
+	bool rowHit;
+};
+
+//Picks the command a channel issues next out of the ready candidates the
+//	command queue finds through its per-bank index. The queue tells the
+//	scheduler about every command entering and leaving it so that a policy can
+//	keep per-source state.
+class Scheduler
+{
+public:
+	Scheduler(IniReader *iniReader_);
+	virtual ~Scheduler() {}
+	//the policy SCHEDULING_POLICY names, NULL for the round robin policies,
+	//	which walk the queues themselves
+	static Scheduler *create(IniReader *iniReader);
+
+	virtual void enqueued(const BusPacket *packet, uint64_t age, uint64_t cycle) {}
+	//issued is false for an activate dropped because its access hit a row
+	//	opened for another request
+	virtual void removed(const BusPacket *packet, uint64_t age, bool issued, uint64_t cycle) {}
+	//index of the candidate to issue, candidates is never empty
+	size_t choose(const std::vector<SchedulerCandidate> &candidates, uint64_t cycle);
+
+protected:
+	//brings the policy's time-based state up to cycle
+	virtual void advance(uint64_t cycle) {}
+	//whether a goes ahead of b
+	virtual bool before(const SchedulerCandidate &a, const SchedulerCandidate &b, uint64_t cycle) = 0;
+	//row hits first, then the oldest
+	static bool firstReady(const SchedulerCandidate &a, const SchedulerCandidate &b);
+
+	IniReader *iniReader;
+};
+
+class FirstReadyFCFSScheduler : public Scheduler
+{
+public:
+	FirstReadyFCFSScheduler(IniReader *iniReader_) : Scheduler(iniReader_) {}
+protected:
+	bool before(const SchedulerCandidate &a, const SchedulerCandidate &b, uint64_t cycle);
+};
+
+//Adaptive per-Thread Least-Attained-Service: sources that have had the
+//	least bank service over the past quanta go first. Each channel's
+//	scheduler attains and ranks service on its own, with no coordination
+//	across controllers at quantum boundaries, which simplifies ATLAS
+class AtlasScheduler : public Scheduler
+{
+public:
+	AtlasScheduler(IniReader *iniReader_);
+	void removed(const BusPacket *packet, uint64_t age, bool issued, uint64_t cycle);
+protected:
+	void advance(uint64_t cycle);
+	bool before(const SchedulerCandidate &a, const SchedulerCandidate &b, uint64_t cycle);
+private:
+	uint64_t quantumEnd;
+	//bank cycles each source got in this quantum, and over the past ones
+	std::vector<uint64_t> service;
+	std::vector<double> attainedService;
+};
+
+//Blacklisting: a source served several times in a row loses its priority
+//	until the blacklist is next cleared
+class BlissScheduler : public Scheduler
+{
+public:
+	BlissScheduler(IniReader *iniReader_);
+	void removed(const BusPacket *packet, uint64_t age, bool issued, uint64_t cycle);
+protected:
+	void advance(uint64_t cycle);
+	bool before(const SchedulerCandidate &a, const SchedulerCandidate &b, uint64_t cycle);
+private:
+	uint64_t nextClearing;
+	unsigned lastSource;
+	unsigned streak;
+	std::vector<bool> blacklisted;
+};
+
+//Parallelism-aware batch scheduling: the oldest requests of each source to
+//	each bank are marked as a batch, which is served ahead of everything else,
+//	sources with the least work in the batch first
+class ParBSScheduler : public Scheduler
+{
+public:
+	ParBSScheduler(IniReader *iniReader_);
+	void enqueued(const BusPacket *packet, uint64_t age, uint64_t cycle);
+	void removed(const BusPacket *packet, uint64_t age, bool issued, uint64_t cycle);
+protected:
+	void advance(uint64_t cycle);
+	bool before(const SchedulerCandidate &a, const SchedulerCandidate &b, uint64_t cycle);
+private:
+	bool isMarked(const SchedulerCandidate &c);
+
+	//queued requests by bank (rank*NUM_BANKS+bank) and source, each by the
+	//	age of its column access, with whether it is in the batch
+	typedef std::map<uint64_t, bool> Requests;
+	std::vector< std::map<unsigned, Requests> > requests;
+	unsigned markedLeft;
+	//the most requests a source has in the batch to any one bank, and in all
+	std::vector<unsigned> maxBankLoad;
+	std::vector<unsigned> totalLoad;
+};
+}
+
+#endif
@@ -66,6 +66,7 @@ extern bool VERIFICATION_OUTPUT; // output suitable to feed to modelsim
 #define TYPE_NVM  1
 #define TYPE_NODEV 9999 
 
+//all channels of all memory types; the ini files set the count per type
 extern unsigned NUM_CHANS;
 extern bool DEBUG_TRANS_Q;
 extern bool DEBUG_CMD_Q;
@@ -86,6 +87,13 @@ extern bool VIS_FILE_OUTPUT;
 #define WRITE_TO_READ_DELAY_B (iniReader->WL+iniReader->BL/2+iniReader->tWTR) //interbank
 #define WRITE_TO_READ_DELAY_R (iniReader->WL+iniReader->BL/2+iniReader->tRTRS-iniReader->RL) //interrank
 
+//cycles from the start of the array write of a WRITE_P to the end of its k-th
+//  program-and-verify iteration: the RESET pulse and k SET pulses, or k of the
+//  WRITE_ITERATIONS steps tRP is split into if the device has no tSET
+#define ARRAY_WRITE_TIME(k) (iniReader->tSET > 0 ? iniReader->tRESET+(k)*iniReader->tSET : (k)*iniReader->tRP/iniReader->WRITE_ITERATIONS)
+//a read can cut into the array write of a WRITE_P
+#define WRITES_INTERRUPTIBLE ((iniReader->WRITE_PAUSING && iniReader->WRITE_ITERATIONS > 1) || iniReader->WRITE_CANCEL_THRESHOLD > 0)
+
 /*
 extern unsigned JEDEC_DATA_BUS_BITS;
 
@@ -118,7 +126,9 @@ enum AddressMappingScheme
 	Scheme4,
 	Scheme5,
 	Scheme6,
-	Scheme7
+	Scheme7,
+	//the field order spelled out in ADDRESS_MAPPING_SCHEME, see AddressMapping.cpp
+	SchemeCustom
 };
 
 // used in MemoryController and CommandQueue
@@ -138,7 +148,11 @@ enum QueuingStructure
 enum SchedulingPolicy
 {
 	RankThenBankRoundRobin,
-	BankThenRankRoundRobin
+	BankThenRankRoundRobin,
+	FirstReadyFCFS,
+	Atlas,
+	Bliss,
+	ParBS
 };
 
 
@@ -0,0 +1,188 @@
+/*********************************************************************************
+*  Copyright (c) 2010-2011, Elliott Cooper-Balis
+*                             Paul Rosenfeld
+*                             Bruce Jacob
+*                             University of Maryland 
+*                             dramninjas [at] gmail [dot] com
+*  All rights reserved.
+*  
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions are met:
+*  
+*     * Redistributions of source code must retain the above copyright notice,
+*        this list of conditions and the following disclaimer.
+*  
+*     * Redistributions in binary form must reproduce the above copyright notice,
+*        this list of conditions and the following disclaimer in the documentation
+*        and/or other materials provided with the distribution.
+*  
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+*  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+*  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+*  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+*  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+
+
+
+//TimingWheel.cpp
+//
+//Class file for the timing wheel that holds the pending timing events of a channel
+//
+
+#include "TimingWheel.h"
+#include <string.h>
+#include <algorithm>
+
+using namespace std;
+
+namespace DRAMSim
+{
+
+TimingWheel::TimingWheel() :
+	now(0)
+{
+	memset(occupied, 0, sizeof(occupied));
+}
+
+void TimingWheel::schedule(uint64_t cycle, TimingEventType type, unsigned rank, unsigned bank)
+{
+	TimingEvent event;
+	event.cycle = cycle;
+	event.type = type;
+	event.rank = rank;
+	event.bank = bank;
+	insert(event);
+}
+
+void TimingWheel::insert(const TimingEvent &event)
+{
+	if (event.cycle < now)
+	{
+		ERROR("== Error - Timing event for cycle "<<event.cycle<<" scheduled at cycle "<<now);
+		abort();
+	}
+	for (unsigned level=0;level<TIMING_WHEEL_LEVELS;level++)
+	{
+		unsigned shift = TIMING_WHEEL_SLOT_BITS*(level+1);
+		//file it at the first level whose higher bits match the current cycle
+		if ((event.cycle >> shift) == (now >> shift))
+		{
+			unsigned slot = (event.cycle >> (TIMING_WHEEL_SLOT_BITS*level)) & (TIMING_WHEEL_SLOTS-1);
+			slots[level][slot].push_back(event);
+			occupied[level][slot/64] |= 1ULL << (slot%64);
+			return;
+		}
+	}
+	overflow.push_back(event);
+}
+
+//re-files events relative to the current cycle, which moves them to a lower level
+void TimingWheel::cascade(vector<TimingEvent> &events)
+{
+	cascading.swap(events);
+	for (size_t i=0;i<cascading.size();i++)
+	{
+		insert(cascading[i]);
+	}
+	cascading.clear();
+}
+
+void TimingWheel::advanceTo(uint64_t cycle)
+{
+	if (cycle <= now)
+	{
+		return;
+	}
+	uint64_t previous = now;
+	now = cycle;
+
+	unsigned topShift = TIMING_WHEEL_SLOT_BITS*TIMING_WHEEL_LEVELS;
+	if ((previous >> topShift) != (cycle >> topShift))
+	{
+		cascade(overflow);
+	}
+	//every slot passed over is empty, so only the slot the new cycle falls in
+	//  has to be taken down, coarsest level first
+	for (unsigned level=TIMING_WHEEL_LEVELS-1;level>0;level--)
+	{
+		unsigned shift = TIMING_WHEEL_SLOT_BITS*level;
+		if ((previous >> shift) != (cycle >> shift))
+		{
+			unsigned slot = (cycle >> shift) & (TIMING_WHEEL_SLOTS-1);
+			occupied[level][slot/64] &= ~(1ULL << (slot%64));
+			cascade(slots[level][slot]);
+		}
+	}
+}
+
+void TimingWheel::expire(uint64_t cycle, vector<TimingEvent> &due)
+{
+	advanceTo(cycle);
+	unsigned slot = cycle & (TIMING_WHEEL_SLOTS-1);
+	vector<TimingEvent> &events = slots[0][slot];
+	for (size_t i=0;i<events.size();i++)
+	{
+		if (events[i].cycle != cycle)
+		{
+			ERROR("== Error - Timing event for cycle "<<events[i].cycle<<" was missed, now at cycle "<<cycle);
+			abort();
+		}
+		due.push_back(events[i]);
+	}
+	events.clear();
+	occupied[0][slot/64] &= ~(1ULL << (slot%64));
+	advanceTo(cycle+1);
+}
+
+//index of the first non-empty slot of level at or after fromSlot, -1 if none
+int TimingWheel::firstOccupied(unsigned level, unsigned fromSlot)
+{
+	for (unsigned word=fromSlot/64;word<TIMING_WHEEL_SLOTS/64;word++)
+	{
+		uint64_t bits = occupied[level][word];
+		if (word == fromSlot/64)
+		{
+			bits &= ~0ULL << (fromSlot%64);
+		}
+		if (bits != 0)
+		{
+			return word*64 + __builtin_ctzll(bits);
+		}
+	}
+	return -1;
+}
+
+uint64_t TimingWheel::nextEventCycle()
+{
+	//every event on a finer level is due before any event on a coarser one
+	for (unsigned level=0;level<TIMING_WHEEL_LEVELS;level++)
+	{
+		unsigned shift = TIMING_WHEEL_SLOT_BITS*level;
+		int slot = firstOccupied(level, (now >> shift) & (TIMING_WHEEL_SLOTS-1));
+		if (slot < 0)
+		{
+			continue;
+		}
+		vector<TimingEvent> &events = slots[level][slot];
+		uint64_t next = UINT64_MAX;
+		for (size_t i=0;i<events.size();i++)
+		{
+			next = min(next, events[i].cycle);
+		}
+		return next;
+	}
+	uint64_t next = UINT64_MAX;
+	for (size_t i=0;i<overflow.size();i++)
+	{
+		next = min(next, overflow[i].cycle);
+	}
+	return next;
+}
+}
@@ -0,0 +1,103 @@
+/*********************************************************************************
+*  Copyright (c) 2010-2011, Elliott Cooper-Balis
+*                             Paul Rosenfeld
+*                             Bruce Jacob
+*                             University of Maryland 
+*                             dramninjas [at] gmail [dot] com
+*  All rights reserved.
+*  
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions are met:
+*  
+*     * Redistributions of source code must retain the above copyright notice,
+*        this list of conditions and the following disclaimer.
+*  
+*     * Redistributions in binary form must reproduce the above copyright notice,
+*        this list of conditions and the following disclaimer in the documentation
+*        and/or other materials provided with the distribution.
+*  
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+*  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+*  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+*  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+*  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+
+
+
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+//TimingWheel.h
+//
+//Header file for the timing wheel that holds the pending timing events of a channel
+//
+
+#include "SystemConfiguration.h"
+#include <vector>
+
+//each level of the wheel resolves 8 more bits of the deadline, so four levels
+//  reach 2^32 cycles ahead; anything further out waits in an overflow list
+#define TIMING_WHEEL_LEVELS 4
+#define TIMING_WHEEL_SLOT_BITS 8
+#define TIMING_WHEEL_SLOTS (1<<TIMING_WHEEL_SLOT_BITS)
+
+namespace DRAMSim
+{
+enum TimingEventType
+{
+	BANK_STATE_CHANGE,
+	ACTIVATE_WINDOW_EXPIRY
+};
+
+struct TimingEvent
+{
+	uint64_t cycle;
+	TimingEventType type;
+	unsigned rank;
+	unsigned bank;
+};
+
+//Hierarchical timing wheel: an event is filed under the coarsest level at
+//  which its deadline still differs from the current cycle and moves down a
+//  level each time the wheel reaches its slot, so scheduling and expiring are
+//  O(1) no matter how many events are pending.
+//
+//Events can't be cancelled; an owner that moves a deadline should ignore the
+//  stale event when it comes due.
+class TimingWheel
+{
+public:
+	TimingWheel();
+	//cycle must not lie before the next cycle to be expired
+	void schedule(uint64_t cycle, TimingEventType type, unsigned rank, unsigned bank);
+	//appends the events due at cycle to due; cycles may be skipped, but only
+	//  up to nextEventCycle()
+	void expire(uint64_t cycle, std::vector<TimingEvent> &due);
+	//the earliest pending deadline, UINT64_MAX if there is none
+	uint64_t nextEventCycle();
+
+private:
+	void insert(const TimingEvent &event);
+	void advanceTo(uint64_t cycle);
+	void cascade(std::vector<TimingEvent> &events);
+	int firstOccupied(unsigned level, unsigned fromSlot);
+
+	//the next cycle to be expired
+	uint64_t now;
+	std::vector<TimingEvent> slots[TIMING_WHEEL_LEVELS][TIMING_WHEEL_SLOTS];
+	//a bit per non-empty slot, so finding the next deadline doesn't walk the slots
+	uint64_t occupied[TIMING_WHEEL_LEVELS][TIMING_WHEEL_SLOTS/64];
+	std::vector<TimingEvent> overflow;
+	std::vector<TimingEvent> cascading;
+};
+}
+
+#endif
+
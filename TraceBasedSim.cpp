@@ -42,6 +42,9 @@
 #include <map>
 #include <list>
 #include <ctime>
+#include <climits>
+#include <thread>
+#include <atomic>
 
 
 #include "SystemConfiguration.h"
@@ -49,6 +52,10 @@
 #include "MultiChannelMemorySystem.h"
 #include "Transaction.h"
 #include "IniReader.h"
+#include "TraceReader.h"
+#include "TraceWriter.h"
+#include "WorkloadGenerator.h"
+#include "SPSCRing.h"
 
 
 using namespace DRAMSim;
@@ -61,21 +68,22 @@ time_t end;
 size_t cpuCycle=0;
 
 
-int64_t *buf;
-unsigned int timer;
-unsigned int r_w;
 unsigned long timerActual = 0;
-unsigned int oldTimer;
+uint64_t oldTimer;
 int flag = 1;
-FILE *fpTrace;
 unsigned long currentNum = 0;
-unsigned long NUM = 100000;
+unsigned long NUM = ULONG_MAX;
 
 
 
 
 //#define RETURN_TRANSACTIONS 1
 
+//number of decoded requests the decode thread may run ahead of the simulation
+#define TRACE_RING_DEPTH 4096
+//number of requests the decode thread maps in one go
+#define TRACE_DECODE_BATCH 64
+
 #ifndef _SIM_
 int SHOW_SIM_OUTPUT = 1;
 ofstream visDataOut; //mostly used in MemoryController
@@ -162,13 +170,13 @@ void usage()
 {
 	cout << "HRAMSim1 Usage: " << endl;
 	cout << "HRAMSim1 -t tracefile -s system.ini -d ini/device.ini [-c #] [-p pwd] [-q] [-S 2048] [-n] [-o OPTION_A=1234,tRC=14,tFAW=19]" <<endl;
-	cout << "\t-t, --tracefile=FILENAME \tspecify a tracefile to run  "<<endl;
+	cout << "\t-t, --tracefile=FILENAME \tspecify a tracefile to run, gzip is inflated on the fly and - reads stdin  "<<endl;
 	cout << "\t-b, --debug=FILENAME \t\tspecify a debug ini file "<<endl;
 	cout << "\t-s, --systemini=FILENAME \tspecify an ini file that describes the memory system parameters  "<<endl;
 	cout << "\t-x, --systeminiPcm=FILENAME \tspecify an ini file that describes the pcm memory system parameters  "<<endl;
 	cout << "\t-d, --deviceini=FILENAME \tspecify an ini file that describes the device-level parameters"<<endl;
 	cout << "\t-e, --deviceiniPcm=FILENAME \tspecify an pcm ini file that describes the device-level parameters"<<endl;
-	cout << "\t-c, --numInstructions=# \tspecify number of instructions to run the simulation for [default=100000] "<<endl;
+	cout << "\t-c, --numInstructions=# \tspecify number of instructions to run the simulation for [default=whole trace] "<<endl;
 	cout << "\t-q, --quiet \t\t\tflag to suppress simulation output (except final stats) [default=no]"<<endl;
 	cout << "\t-o, --option=OPTION_A=234,tFAW=14\toverwrite any ini file option from the command line"<<endl;
 	cout << "\t-p, --pwd=DIRECTORY\t\tSet the working directory (i.e. usually DRAMSim directory where ini/ and results/ are)"<<endl;
@@ -176,20 +184,26 @@ void usage()
 	cout << "\t-X, --sizePcm=# \t\tSize of the pcm memory system in megabytes [default=2048M]"<<endl;
 	cout << "\t-n, --notiming \t\t\tDo not use the clock cycle information in the trace file"<<endl;
 	cout << "\t-v, --visfile \t\t\tVis output filename"<<endl;
+	cout << "\t-T, --threadedDecode \t\tDecode the trace on a separate thread [default=no]"<<endl;
+	cout << "\t-F, --fastForward \t\tSkip over cycles in which no memory system state can change, results are unchanged [default=no]"<<endl;
+	cout << "\t-P, --parallel \t\t\tUpdate each channel on a thread of its own, results are unchanged [default=no]"<<endl;
+	cout << "\t-r, --startRecord=# \t\tStart the run at this record of the trace [default=0]"<<endl;
+	cout << "\t-C, --convert=FILENAME \t\tConvert the trace to the v2 block format and exit"<<endl;
+	cout << "\t-g, --generate=pattern=zipf,rate=0.05\tReplace the trace by a synthetic request stream, may be repeated"<<endl;
+	cout << "\t\t\t\t\tpattern=seq|stride|random|zipf|chase requests=# rate=#/cycle arrival=fixed|poisson"<<endl;
+	cout << "\t\t\t\t\treads=0.7 nvm=0 footprint=64(MB) base=0(MB) stride=#(bytes) zipf=0.99"<<endl;
+	cout << "\t-R, --seed=# \t\t\tSeed of the synthetic workload [default=1]"<<endl;
 }
 #endif
 
-void *parseTraceFileLine_new(uint64_t &addr, enum TransactionType &transType, uint64_t &clockCycle, TraceType type, bool useClockCycle)
+void *parseTraceFileLine_new(const TraceRecord &record, uint64_t &addr, enum TransactionType &transType, uint64_t &clockCycle, TraceType type, bool useClockCycle)
 {
 
 	uint64_t *dataBuffer = NULL;
-	string addressStr="", cmdStr="", dataStr="", ccStr="";
 	
 	
 		
-	timer  = (unsigned int)( ((buf[currentNum])>>30) & 0xfffffULL);
-	r_w    = (unsigned int)( ((buf[currentNum])>>29) & 0x1ULL );
-	addr   = (uint64_t)( (buf[currentNum]<<3) & 0xffffffffULL );
+	addr   = record.address;
 	if(flag)		
 	{			
 		flag = 0;
@@ -200,18 +214,13 @@ void *parseTraceFileLine_new(uint64_t &addr, enum TransactionType &transType, ui
 	}
 	
 	
-	if(r_w == 1)
+	if(record.isRead)
 	{
 		transType = DATA_READ;
 	}
-	else if(r_w == 0)
-	{
-		transType = DATA_WRITE;
-	}
 	else
 	{
-		ERROR("== Unknown Command : "<<cmdStr);
-		exit(0);
+		transType = DATA_WRITE;
 	}
 
 	//istringstream a(addressStr.substr(2));//gets rid of 0x
@@ -225,7 +234,7 @@ void *parseTraceFileLine_new(uint64_t &addr, enum TransactionType &transType, ui
 		clockCycle = timerActual;
 	}
 	
-	oldTimer = timer*5;
+	oldTimer = record.gap;
 	
 
 	return dataBuffer;
@@ -246,6 +255,183 @@ void alignTransactionAddress(Transaction &trans)
   */
 }
 
+//a decoded trace record, ready to be handed to the memory system
+struct TraceRequest
+{
+	TraceRequest() :
+		trans(DATA_READ, 0, NULL),
+		clockCycle(0),
+		channel(0),
+		endOfTrace(false)
+	{}
+	// copied into the pool of the channel when it's added, so decoding
+	// doesn't touch the heap
+	Transaction trans;
+	uint64_t clockCycle;
+	unsigned channel;
+	bool endOfTrace;
+};
+
+//parses the next trace record into a request without mapping its address,
+//  returns false at the end of the trace
+bool parseTraceRequest(TraceReader *traceReader, TraceType traceType, bool useClockCycle, TraceRequest &req)
+{
+	TraceRecord record;
+	uint64_t addr;
+	enum TransactionType transType;
+
+	if (!traceReader->nextRecord(record))
+	{
+		return false;
+	}
+	req.clockCycle = 0;
+	void *data = parseTraceFileLine_new(record, addr, transType, req.clockCycle, traceType, useClockCycle);
+	req.trans = Transaction(transType, addr, data);
+	alignTransactionAddress(req.trans); 
+	return true;
+}
+
+void setRequestMapping(TraceRequest &req, const DecodedAddress &decoded)
+{
+	req.trans.setMapping(decoded);
+	req.channel = decoded.channel;
+}
+
+//decodes the next trace record into a request, returns false at the end of the trace
+bool decodeTraceRequest(TraceReader *traceReader, MultiChannelMemorySystem *memorySystem, TraceType traceType, bool useClockCycle, TraceRequest &req)
+{
+	if (!parseTraceRequest(traceReader, traceType, useClockCycle, req))
+	{
+		return false;
+	}
+	DecodedAddress decoded;
+	memorySystem->getAddressMapping().decode(req.trans.address, decoded);
+	setRequestMapping(req, decoded);
+	return true;
+}
+
+/**
+ * Pipeline stage that decodes the trace on its own thread. The simulation
+ * loop just pops finished requests off of the ring, so record decoding,
+ * timer accumulation and address mapping no longer
+ * share a core with the memory system. The stall counters of the ring show
+ * which side is the bottleneck.
+ **/
+class TraceDecodeStage
+{
+	public:
+		TraceDecodeStage(TraceReader *traceReader_, MultiChannelMemorySystem *memorySystem_, TraceType traceType_, bool useClockCycle_, unsigned long maxRequests_) :
+			traceReader(traceReader_),
+			memorySystem(memorySystem_),
+			traceType(traceType_),
+			useClockCycle(useClockCycle_),
+			maxRequests(maxRequests_),
+			ring(TRACE_RING_DEPTH),
+			stop(false),
+			finished(false),
+			numRequests(0)
+		{
+			producer = thread(&TraceDecodeStage::run, this);
+		}
+
+		~TraceDecodeStage()
+		{
+			stop = true;
+			producer.join();
+		}
+
+		//blocks until the next request has been decoded, returns false at the end of the trace
+		bool pop(TraceRequest &req)
+		{
+			if (finished)
+			{
+				return false;
+			}
+			ring.pop(req);
+			if (req.endOfTrace)
+			{
+				finished = true;
+				return false;
+			}
+			numRequests++;
+			return true;
+		}
+
+		void printStats()
+		{
+			cout<<"decode ring: "<<numRequests<<" requests, "<<ring.getPushStalls()<<" decoder stalls (ring full, simulation bound), "
+				<<ring.getPopStalls()<<" simulator stalls (ring empty, decode bound)"<<endl;
+		}
+
+	private:
+		// producer thread; only decodes as many records as the simulation can consume
+		// so that the trace timer globals end up exactly where a serial run leaves them.
+		// records are parsed a batch at a time and their addresses mapped together
+		void run()
+		{
+			TraceRequest batch[TRACE_DECODE_BATCH];
+			uint64_t addresses[TRACE_DECODE_BATCH];
+			DecodedAddress decoded[TRACE_DECODE_BATCH];
+			unsigned long numParsed = 0;
+			bool traceLeft = true;
+			while (traceLeft)
+			{
+				size_t count = 0;
+				while (count < TRACE_DECODE_BATCH)
+				{
+					if (numParsed == maxRequests || !parseTraceRequest(traceReader, traceType, useClockCycle, batch[count]))
+					{
+						traceLeft = false;
+						break;
+					}
+					addresses[count] = batch[count].trans.address;
+					count++;
+					numParsed++;
+				}
+				memorySystem->getAddressMapping().decode(addresses, count, decoded);
+				for (size_t i=0; i<count; i++)
+				{
+					setRequestMapping(batch[i], decoded[i]);
+					if (!ring.push(batch[i], stop))
+					{
+						return;
+					}
+				}
+			}
+			TraceRequest req;
+			req.endOfTrace = true;
+			ring.push(req, stop);
+		}
+
+		TraceReader *traceReader;
+		MultiChannelMemorySystem *memorySystem;
+		TraceType traceType;
+		bool useClockCycle;
+		unsigned long maxRequests;
+		SPSCRing<TraceRequest> ring;
+		atomic<bool> stop;
+		bool finished;
+		uint64_t numRequests;
+		thread producer;
+};
+
+//re-encodes a trace of any readable format into the v2 block container
+void convertTrace(const string &inFilename, const string &outFilename)
+{
+	TraceReader *traceReader = TraceReader::open(inFilename);
+	BlockTraceWriter traceWriter(outFilename);
+	TraceRecord record;
+
+	while (traceReader->nextRecord(record))
+	{
+		traceWriter.addRecord(record);
+	}
+	traceWriter.close();
+	delete traceReader;
+
+	cout << "== Converted "<<traceWriter.getNumRecords()<<" records into '"<<outFilename<<"' ("<<traceWriter.getBytesWritten()<<" bytes) =="<<endl;
+}
+
 /** 
  * Override options can be specified on the command line as -o key1=value1,key2=value2
  * this method should parse the key-value pairs and put them into a map 
@@ -282,7 +468,7 @@ IniReader::OverrideMap *parseParamOverrides(const string &kv_str)
 int main(int argc, char **argv)
 {
 	
-	begin = clock();
+	::begin = clock();
 	
 	int c;
 	TraceType traceType;
@@ -297,6 +483,13 @@ int main(int argc, char **argv)
 	unsigned megsOfMemory=2048;
 	unsigned megsOfMemoryPcm=2048;
 	bool useClockCycle=true;
+	bool threadedDecode=false;
+	bool fastForward=false;
+	bool parallel=false;
+	uint64_t startRecord=0;
+	string convertFileName;
+	vector<string> generatorSpecs;
+	uint64_t generatorSeed=1;
 	
 	IniReader::OverrideMap *paramOverrides = NULL; 
 
@@ -320,10 +513,17 @@ int main(int argc, char **argv)
 			{"size", required_argument, 0, 'S'},
 			{"sizePcm", required_argument, 0, 'X'},
 			{"visfile", required_argument, 0, 'v'},
+			{"threadedDecode", no_argument, 0, 'T'},
+			{"fastForward", no_argument, 0, 'F'},
+			{"parallel", no_argument, 0, 'P'},
+			{"startRecord", required_argument, 0, 'r'},
+			{"convert", required_argument, 0, 'C'},
+			{"generate", required_argument, 0, 'g'},
+			{"seed", required_argument, 0, 'R'},
 			{0, 0, 0, 0}
 		};
 		int option_index=0; //for getopt
-		c = getopt_long (argc, argv, "t:b:s:x:c:d:e:o:p:X:S:v:qn", long_options, &option_index);
+		c = getopt_long (argc, argv, "t:b:s:x:c:d:e:o:p:X:S:v:r:C:g:R:qnTFP", long_options, &option_index);
 		if (c == -1)
 		{
 			break;
@@ -383,6 +583,27 @@ int main(int argc, char **argv)
 		case 'n':
 			useClockCycle=false;
 			break;
+		case 'T':
+			threadedDecode=true;
+			break;
+		case 'F':
+			fastForward=true;
+			break;
+		case 'P':
+			parallel=true;
+			break;
+		case 'r':
+			startRecord = strtoull(optarg, NULL, 10);
+			break;
+		case 'C':
+			convertFileName = string(optarg);
+			break;
+		case 'g':
+			generatorSpecs.push_back(string(optarg));
+			break;
+		case 'R':
+			generatorSeed = strtoull(optarg, NULL, 10);
+			break;
 		case 'o':
 			paramOverrides = parseParamOverrides(string(optarg)); 
 			break;
@@ -422,6 +643,18 @@ int main(int argc, char **argv)
 */
 	traceType = k6;
 
+	//ignore the pwd argument if the argument is an absolute path
+	if (pwdString.length() > 0 && traceFileName.length() > 0 && traceFileName[0] != '/' && traceFileName != "-")
+	{
+		traceFileName = pwdString + "/" +traceFileName;
+	}
+
+	if (convertFileName.length() > 0)
+	{
+		convertTrace(traceFileName, convertFileName);
+		exit(0);
+	}
+
 	// no default value for the default model name
 	if (deviceIniFilename.length() == 0)
 	{
@@ -431,13 +664,20 @@ int main(int argc, char **argv)
 	}
 
 
-	//ignore the pwd argument if the argument is an absolute path
-	if (pwdString.length() > 0 && traceFileName[0] != '/')
+	if (generatorSpecs.size() > 0)
 	{
-		traceFileName = pwdString + "/" +traceFileName;
+		if (traceFileName.length() > 0)
+		{
+			ERROR("Please give either a trace file or a synthetic workload, not both");
+			exit(-1);
+		}
+		// only used to name the output files
+		traceFileName = "synthetic";
+	}
+	else
+	{
+		DEBUG("== Loading trace file '"<<traceFileName<<"' == ");
 	}
-
-	DEBUG("== Loading trace file '"<<traceFileName<<"' == ");
 
 	ifstream traceFile;
 	string line;
@@ -460,11 +700,9 @@ int main(int argc, char **argv)
 #endif
 
 
-	uint64_t addr;
 	uint64_t clockCycle=0;
-	enum TransactionType transType;
 
-	void *data = NULL;
+	TraceRequest req;
 	Transaction *trans=NULL;
 	bool pendingTrans = false;
 
@@ -478,85 +716,154 @@ int main(int argc, char **argv)
 	}
 */	
 
-	buf = (int64_t*)malloc(8*NUM);
-	if(!buf)     
-	{        
-		cout<<"malloc failed"<<endl;       
-		exit(0);  
-	}
-	if((fpTrace = fopen(traceFileName.c_str(), "r")) == NULL)    
-	{        
-		cout<<"Open traceFile  error"<<endl;
-		exit(0);
-	}
-	if(fread(buf,8, NUM,fpTrace)!=NUM)
-	{	
-		cout<<"No enough requests in the input trace."<<endl;
-		exit(0);
+	WorkloadGenerator *generator = NULL;
+	if (generatorSpecs.size() > 0)
+	{
+		generator = new WorkloadGenerator(generatorSeed, (uint64_t)megsOfMemory<<20, (uint64_t)megsOfMemoryPcm<<20);
+		for (size_t i=0; i<generatorSpecs.size(); i++)
+		{
+			IniReader::OverrideMap *streamParams = parseParamOverrides(generatorSpecs[i]);
+			generator->addStream(*streamParams);
+			delete streamParams;
+		}
+		// pointer chases need to know when their reads come back
+		memorySystem->RegisterCallbacks(new Callback<WorkloadGenerator, void, unsigned, uint64_t, uint64_t>(generator, &WorkloadGenerator::readComplete), NULL, NULL);
 	}
 
-	while(currentNum<NUM)
+	if (generator)
 	{
-		cpuCycle++;
-		if (!pendingTrans)
+		if (parallel)
+		{
+			PRINT("== Pointer chases wait on completions, synthetic workloads update the channels sequentially");
+		}
+		// requests are made up on the fly, there is no trace to read at all
+		while(currentNum<NUM && (trans != NULL || !generator->isDone()))
 		{
-			if (!feof(fpTrace))
+			cpuCycle++;
+			if (trans == NULL)
 			{
+				trans = generator->nextRequest(cpuCycle);
+			}
+			if (trans != NULL && (*memorySystem).addTransaction(trans))
+			{
+				trans=NULL;
+				currentNum++;
+			}
 
-				
-					data = parseTraceFileLine_new(addr, transType,clockCycle, traceType,useClockCycle);
-					trans = new Transaction(transType, addr, data);
-					alignTransactionAddress(*trans); 
+			(*memorySystem).update();
+		}
+		generator->printStats();
+	}
+	else
+	{
+		// records are streamed from the trace as they are needed rather than being
+		// read in up front, so the length of the trace is only bounded by the disk
+		TraceReader *traceReader = TraceReader::open(traceFileName);
+		// the first request replayed is issued at cycle 0 regardless of where it sits in the trace
+		if (startRecord > 0 && !traceReader->seek(startRecord))
+		{
+			ERROR("== Error - Trace '"<<traceFileName<<"' has fewer than "<<startRecord<<" records");
+			exit(-1);
+		}
+		TraceDecodeStage *decodeStage = NULL;
+		if (threadedDecode)
+		{
+			decodeStage = new TraceDecodeStage(traceReader, memorySystem, traceType, useClockCycle, NUM);
+		}
+		bool parallelChannels = parallel && memorySystem->startParallel(fastForward);
+		// in parallel mode the request after the pending one is decoded early,
+		// its arrival bounds how far the other channels may run ahead
+		TraceRequest nextReq;
+		bool haveNextReq = false;
+		bool traceEnded = false;
+
+		while(currentNum<NUM)
+		{
+			if (!pendingTrans)
+			{
+				//running out of trace is the natural end of the run
+				bool gotRequest = !traceEnded;
+				if (haveNextReq)
+				{
+					req = nextReq;
+					haveNextReq = false;
+				}
+				else if (gotRequest)
+				{
+					gotRequest = decodeStage ? decodeStage->pop(req) :
+						decodeTraceRequest(traceReader, memorySystem, traceType, useClockCycle, req);
+				}
+				if (!gotRequest)
+				{
+					break;
+				}
+				clockCycle = req.clockCycle;
+				pendingTrans = true;
 
-					if (cpuCycle>=clockCycle)
+				if (parallelChannels)
+				{
+					// the request is added once the memory system has been updated
+					// clockCycle-1 times and the one after it no earlier, so the
+					// channels can be left to get that far on their own; only what
+					// the run will actually use is decoded
+					uint64_t lookahead = clockCycle;
+					if (currentNum + 1 < NUM)
 					{
-						if (!(*memorySystem).addTransaction(trans))
-						{
-							pendingTrans = true;
-						}
-						else
+						haveNextReq = decodeStage ? decodeStage->pop(nextReq) :
+							decodeTraceRequest(traceReader, memorySystem, traceType, useClockCycle, nextReq);
+						traceEnded = !haveNextReq;
+						if (haveNextReq)
 						{
-#ifdef RETURN_TRANSACTIONS
-							transactionReceiver.add_pending(trans, cpuCycle); 
-#endif
-							// the memory system accepted our request so now it takes ownership of it
-							trans = NULL; 
-							currentNum++;
-
+							lookahead = nextReq.clockCycle;
 						}
 					}
-					else
+					for (unsigned c=0; c<NUM_CHANS; c++)
 					{
-						pendingTrans = true;
+						uint64_t arrival = c == req.channel ? clockCycle : lookahead;
+						memorySystem->setHorizon(c, max(arrival, (uint64_t)1) - 1);
 					}
-				
+				}
 			}
-			else
+
+			// nothing arrives before clockCycle, so the cycles up to then are
+			// skipped as far as the memory system allows; the channel workers of
+			// the parallel mode catch up by themselves, so it always skips them
+			if ((fastForward || parallelChannels) && pendingTrans && clockCycle > cpuCycle + 1)
 			{
-				//we're out of trace, set pending=false and let the thing spin without adding transactions
-				pendingTrans = false; 
+				cpuCycle += memorySystem->fastForward(clockCycle - cpuCycle - 1);
+			}
+			// a request turned away by a full transaction queue is turned away
+			// again on every cycle until the channel's next event
+			else if (fastForward && pendingTrans && !memorySystem->channelWillAcceptTransaction(req.channel, req.trans.transactionType))
+			{
+				cpuCycle += memorySystem->fastForward(UINT64_MAX);
 			}
-		}
 
-		else if (pendingTrans && cpuCycle >= clockCycle)
-		{
-			pendingTrans = !(*memorySystem).addTransaction(trans);
-			if (!pendingTrans)
+			cpuCycle++;
+			if (pendingTrans && cpuCycle >= clockCycle)
 			{
+				pendingTrans = !(*memorySystem).addTransaction(req.trans, req.channel);
+				if (!pendingTrans)
+				{
 #ifdef RETURN_TRANSACTIONS
-				transactionReceiver.add_pending(trans, cpuCycle); 
+					transactionReceiver.add_pending(req.trans, cpuCycle); 
 #endif
-				trans=NULL;
-				currentNum++;
+					currentNum++;
 
+				}
 			}
+
+			(*memorySystem).update();
 		}
 
-		(*memorySystem).update();
+		//traceFile.close();
+		if (decodeStage)
+		{
+			decodeStage->printStats();
+			delete decodeStage;
+		}
+		delete traceReader;
 	}
-
-	//traceFile.close();
-	fclose(fpTrace);
 	memorySystem->printStats(true);
 	// make valgrind happy
 	if (trans)
@@ -564,12 +871,13 @@ int main(int argc, char **argv)
 		delete trans;
 	}
 	delete(memorySystem);
+	delete generator;
 
-	end = clock();
+	::end = clock();
 
 	cout<<"clock:"<<cpuCycle<<endl;
-	cout<< "Running time is: "<<static_cast<double>(end-begin)/CLOCKS_PER_SEC/60<<"min"<<endl;
-	cout<< "Running time is: "<<static_cast<double>(end-begin)/CLOCKS_PER_SEC*1000<<"ms"<<endl;
+	cout<< "Running time is: "<<static_cast<double>(::end-::begin)/CLOCKS_PER_SEC/60<<"min"<<endl;
+	cout<< "Running time is: "<<static_cast<double>(::end-::begin)/CLOCKS_PER_SEC*1000<<"ms"<<endl;
   
 }
 #endif
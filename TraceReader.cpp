@@ -0,0 +1,544 @@
+/*********************************************************************************
+*  Copyright (c) 2010-2011, Elliott Cooper-Balis
+*                             Paul Rosenfeld
+*                             Bruce Jacob
+*                             University of Maryland 
+*                             dramninjas [at] gmail [dot] com
+*  All rights reserved.
+*  
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions are met:
+*  
+*     * Redistributions of source code must retain the above copyright notice,
+*        this list of conditions and the following disclaimer.
+*  
+*     * Redistributions in binary form must reproduce the above copyright notice,
+*        this list of conditions and the following disclaimer in the documentation
+*        and/or other materials provided with the distribution.
+*  
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+*  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+*  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+*  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+*  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+
+
+
+//TraceReader.cpp
+//
+//Class file for the trace reader objects
+//
+
+#include "TraceReader.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <sys/stat.h>
+#include <zlib.h>
+
+//size of each mapped chunk of the trace file; rounded to the page size
+#define TRACE_WINDOW_BYTES (64UL<<20)
+#define TRACE_RECORD_BYTES 8
+//size of each read from a streamed trace and of its inflate buffer
+#define TRACE_STREAM_CHUNK_BYTES (256UL<<10)
+#define TRACE_GZIP_MAGIC0 0x1f
+#define TRACE_GZIP_MAGIC1 0x8b
+
+using namespace std;
+
+namespace DRAMSim
+{
+
+TraceReader *TraceReader::open(const string &filename)
+{
+	unsigned char magic[TRACE_V2_MAGIC_BYTES];
+	size_t magicBytes = 0;
+	struct stat stat_buf;
+
+	//"-" replays the trace from stdin
+	int fd = filename == "-" ? dup(STDIN_FILENO) : ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0 || fstat(fd, &stat_buf) != 0)
+	{
+		ERROR("== Error - Could not open trace file '"<<filename<<"': "<<strerror(errno));
+		exit(-1);
+	}
+	while (magicBytes < TRACE_V2_MAGIC_BYTES)
+	{
+		ssize_t n = read(fd, magic + magicBytes, TRACE_V2_MAGIC_BYTES - magicBytes);
+		if (n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n <= 0)
+		{
+			break;
+		}
+		magicBytes += n;
+	}
+
+	bool isV2 = magicBytes == TRACE_V2_MAGIC_BYTES && memcmp(magic, TRACE_V2_MAGIC, TRACE_V2_MAGIC_BYTES) == 0;
+	bool isGzip = magicBytes >= 2 && magic[0] == TRACE_GZIP_MAGIC0 && magic[1] == TRACE_GZIP_MAGIC1;
+	if (isV2 && !S_ISREG(stat_buf.st_mode))
+	{
+		ERROR("== Error - v2 trace '"<<filename<<"' has to be a regular file, its index sits at the end");
+		exit(-1);
+	}
+	//pipes cannot be rewound, so the stream reader takes over the bytes sniffed so far
+	if (isGzip || !S_ISREG(stat_buf.st_mode))
+	{
+		return new StreamTraceReader(filename, fd, magic, magicBytes);
+	}
+	close(fd);
+
+	if (isV2)
+	{
+		return new BlockTraceReader(filename);
+	}
+	//anything else is taken to be a legacy trace
+	return new MmapTraceReader(filename);
+}
+
+bool TraceReader::seek(uint64_t recordNumber)
+{
+	//formats without an index can only skip forward record by record
+	TraceRecord record;
+	for (uint64_t i=0; i<recordNumber; i++)
+	{
+		if (!nextRecord(record))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void TraceReader::decodeLegacyRecord(int64_t raw, TraceRecord &record)
+{
+	//the timer field counts in units of 5 cpu cycles
+	record.gap     = ((raw>>30) & 0xfffffULL) * 5;
+	record.isRead  = ((raw>>29) & 0x1ULL) == 1;
+	record.address = (uint64_t)( (raw<<3) & 0xffffffffULL );
+}
+
+MmapTraceReader::MmapTraceReader(const string &filename) :
+	fd(-1),
+	fileSize(0),
+	windowSize(0),
+	windowStart(0),
+	windowEnd(0),
+	window(NULL),
+	offset(0)
+{
+	struct stat stat_buf;
+
+	fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0 || fstat(fd, &stat_buf) != 0)
+	{
+		ERROR("== Error - Could not open trace file '"<<filename<<"': "<<strerror(errno));
+		exit(-1);
+	}
+	fileSize = stat_buf.st_size;
+	if (fileSize % TRACE_RECORD_BYTES != 0)
+	{
+		ERROR("Warning: trace file '"<<filename<<"' ends with a partial record, ignoring the last "<<fileSize % TRACE_RECORD_BYTES<<" bytes");
+		fileSize -= fileSize % TRACE_RECORD_BYTES;
+	}
+
+	uint64_t pageSize = sysconf(_SC_PAGESIZE);
+	windowSize = (TRACE_WINDOW_BYTES / pageSize) * pageSize;
+}
+
+MmapTraceReader::~MmapTraceReader()
+{
+	unmapWindow();
+	if (fd >= 0)
+	{
+		close(fd);
+	}
+}
+
+void MmapTraceReader::mapWindow(uint64_t start)
+{
+	uint64_t length = min(windowSize, fileSize - start);
+	void *addr = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, start);
+	if (addr == MAP_FAILED)
+	{
+		ERROR("== Error - Could not map trace file at offset "<<start<<": "<<strerror(errno));
+		exit(-1);
+	}
+	//the trace is consumed front to back, let the kernel read ahead aggressively
+	madvise(addr, length, MADV_SEQUENTIAL);
+
+	window = (const char *)addr;
+	windowStart = start;
+	windowEnd = start + length;
+}
+
+void MmapTraceReader::unmapWindow()
+{
+	if (window != NULL)
+	{
+		munmap((void *)window, windowEnd - windowStart);
+		window = NULL;
+	}
+}
+
+bool MmapTraceReader::nextRecord(TraceRecord &record)
+{
+	int64_t raw;
+
+	if (offset >= fileSize)
+	{
+		return false;
+	}
+	//windows are a multiple of the record size, so a record never straddles two of them
+	if (window == NULL || offset >= windowEnd)
+	{
+		unmapWindow();
+		//mmap wants a page aligned offset, windows always start on a window boundary
+		mapWindow(offset - offset % windowSize);
+	}
+	memcpy(&raw, window + (offset - windowStart), TRACE_RECORD_BYTES);
+	offset += TRACE_RECORD_BYTES;
+	decodeLegacyRecord(raw, record);
+	return true;
+}
+
+bool MmapTraceReader::seek(uint64_t recordNumber)
+{
+	if (recordNumber > fileSize / TRACE_RECORD_BYTES)
+	{
+		return false;
+	}
+	unmapWindow();
+	offset = recordNumber * TRACE_RECORD_BYTES;
+	return true;
+}
+
+StreamTraceReader::StreamTraceReader(const string &filename_, int fd_, const unsigned char *prefix, size_t prefixBytes) :
+	filename(filename_),
+	fd(fd_),
+	compressed(false),
+	midStream(false),
+	inputDone(false),
+	input(TRACE_STREAM_CHUNK_BYTES),
+	output(TRACE_STREAM_CHUNK_BYTES),
+	outputStart(0),
+	outputEnd(0)
+{
+	compressed = prefixBytes >= 2 && prefix[0] == TRACE_GZIP_MAGIC0 && prefix[1] == TRACE_GZIP_MAGIC1;
+
+	memset(&zstream, 0, sizeof(zstream));
+	//window bits of 15+16 only accept the gzip wrapper
+	if (compressed && inflateInit2(&zstream, 15 + 16) != Z_OK)
+	{
+		ERROR("== Error - Could not set up zlib for trace file '"<<filename<<"'");
+		exit(-1);
+	}
+	memcpy(input.data(), prefix, prefixBytes);
+	zstream.next_in = input.data();
+	zstream.avail_in = prefixBytes;
+}
+
+StreamTraceReader::~StreamTraceReader()
+{
+	if (compressed)
+	{
+		inflateEnd(&zstream);
+	}
+	close(fd);
+}
+
+void StreamTraceReader::readInput()
+{
+	ssize_t n;
+	do
+	{
+		n = read(fd, input.data(), input.size());
+	} while (n < 0 && errno == EINTR);
+
+	if (n < 0)
+	{
+		ERROR("== Error - Could not read trace file '"<<filename<<"': "<<strerror(errno));
+		exit(-1);
+	}
+	inputDone = n == 0;
+	zstream.next_in = input.data();
+	zstream.avail_in = n;
+}
+
+bool StreamTraceReader::refill()
+{
+	//keep the undecoded tail of a record that straddled the previous chunk
+	memmove(output.data(), output.data() + outputStart, outputEnd - outputStart);
+	outputEnd -= outputStart;
+	outputStart = 0;
+
+	while (outputEnd < output.size())
+	{
+		if (zstream.avail_in == 0)
+		{
+			if (inputDone)
+			{
+				break;
+			}
+			readInput();
+			continue;
+		}
+
+		if (!compressed)
+		{
+			size_t n = min((size_t)zstream.avail_in, output.size() - outputEnd);
+			memcpy(output.data() + outputEnd, zstream.next_in, n);
+			zstream.next_in += n;
+			zstream.avail_in -= n;
+			outputEnd += n;
+			continue;
+		}
+
+		zstream.next_out = output.data() + outputEnd;
+		zstream.avail_out = output.size() - outputEnd;
+		int ret = inflate(&zstream, Z_NO_FLUSH);
+		outputEnd = output.size() - zstream.avail_out;
+		if (ret == Z_STREAM_END)
+		{
+			//concatenated gzip members simply continue the trace
+			inflateReset(&zstream);
+			midStream = false;
+		}
+		else if (ret == Z_OK || ret == Z_BUF_ERROR)
+		{
+			midStream = true;
+		}
+		else
+		{
+			ERROR("== Error - Trace file '"<<filename<<"' is not a valid gzip stream: "<<(zstream.msg ? zstream.msg : "unknown error"));
+			exit(-1);
+		}
+	}
+
+	if (outputEnd < TRACE_RECORD_BYTES)
+	{
+		if (midStream)
+		{
+			ERROR("Warning: trace file '"<<filename<<"' ends in the middle of a gzip stream");
+			midStream = false;
+		}
+		if (outputEnd > 0)
+		{
+			ERROR("Warning: trace file '"<<filename<<"' ends with a partial record, ignoring the last "<<outputEnd<<" bytes");
+			outputEnd = 0;
+		}
+		return false;
+	}
+	return true;
+}
+
+bool StreamTraceReader::nextRecord(TraceRecord &record)
+{
+	int64_t raw;
+
+	if (outputEnd - outputStart < TRACE_RECORD_BYTES && !refill())
+	{
+		return false;
+	}
+	memcpy(&raw, output.data() + outputStart, TRACE_RECORD_BYTES);
+	outputStart += TRACE_RECORD_BYTES;
+	decodeLegacyRecord(raw, record);
+	return true;
+}
+
+static uint64_t readLittleEndian(const unsigned char *bytes, unsigned numBytes)
+{
+	uint64_t value = 0;
+	for (unsigned i=0; i<numBytes; i++)
+	{
+		value |= (uint64_t)bytes[i] << (8*i);
+	}
+	return value;
+}
+
+//decodes one LEB128 varint, returns false if it runs past the end of the buffer
+static bool readVarint(const vector<unsigned char> &buf, size_t &pos, uint64_t &value)
+{
+	value = 0;
+	for (unsigned shift=0; shift<64 && pos<buf.size(); shift+=7)
+	{
+		unsigned char byte = buf[pos++];
+		value |= (uint64_t)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+BlockTraceReader::BlockTraceReader(const string &filename_) :
+	filename(filename_),
+	fd(-1),
+	numRecords(0),
+	currentBlock(0),
+	nextBlock(0),
+	payloadOffset(0),
+	recordsLeftInBlock(0),
+	previousAddress(0)
+{
+	struct stat stat_buf;
+	unsigned char header[TRACE_V2_HEADER_BYTES];
+	unsigned char footer[TRACE_V2_FOOTER_BYTES];
+
+	fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0 || fstat(fd, &stat_buf) != 0)
+	{
+		ERROR("== Error - Could not open trace file '"<<filename<<"': "<<strerror(errno));
+		exit(-1);
+	}
+	uint64_t fileSize = stat_buf.st_size;
+	if (fileSize < TRACE_V2_HEADER_BYTES + TRACE_V2_FOOTER_BYTES)
+	{
+		ERROR("== Error - Trace file '"<<filename<<"' is too short to be a v2 trace");
+		exit(-1);
+	}
+
+	readAt(0, header, TRACE_V2_HEADER_BYTES);
+	unsigned version = readLittleEndian(header + TRACE_V2_MAGIC_BYTES, 4);
+	if (version != TRACE_V2_VERSION)
+	{
+		ERROR("== Error - Trace file '"<<filename<<"' has unsupported version "<<version);
+		exit(-1);
+	}
+
+	//a file without a valid footer was not closed properly by the converter
+	readAt(fileSize - TRACE_V2_FOOTER_BYTES, footer, TRACE_V2_FOOTER_BYTES);
+	if (memcmp(footer + 24, TRACE_V2_INDEX_MAGIC, TRACE_V2_MAGIC_BYTES) != 0)
+	{
+		ERROR("== Error - Trace file '"<<filename<<"' has no block index, it is probably truncated");
+		exit(-1);
+	}
+	uint64_t indexOffset = readLittleEndian(footer, 8);
+	uint64_t numBlocks = readLittleEndian(footer + 8, 8);
+	numRecords = readLittleEndian(footer + 16, 8);
+	if (indexOffset + numBlocks * TRACE_V2_INDEX_ENTRY_BYTES + TRACE_V2_FOOTER_BYTES != fileSize)
+	{
+		ERROR("== Error - Trace file '"<<filename<<"' has a corrupt block index");
+		exit(-1);
+	}
+
+	vector<unsigned char> index(numBlocks * TRACE_V2_INDEX_ENTRY_BYTES);
+	readAt(indexOffset, index.data(), index.size());
+	for (uint64_t i=0; i<numBlocks; i++)
+	{
+		blockOffsets.push_back(readLittleEndian(&index[i*TRACE_V2_INDEX_ENTRY_BYTES], 8));
+		blockFirstRecords.push_back(readLittleEndian(&index[i*TRACE_V2_INDEX_ENTRY_BYTES + 8], 8));
+	}
+}
+
+BlockTraceReader::~BlockTraceReader()
+{
+	if (fd >= 0)
+	{
+		close(fd);
+	}
+}
+
+void BlockTraceReader::readAt(uint64_t fileOffset, void *dest, uint64_t length)
+{
+	uint64_t done = 0;
+	while (done < length)
+	{
+		ssize_t n = pread(fd, (char *)dest + done, length - done, fileOffset + done);
+		if (n <= 0)
+		{
+			ERROR("== Error - Could not read trace file '"<<filename<<"' at offset "<<fileOffset + done);
+			exit(-1);
+		}
+		done += n;
+	}
+}
+
+void BlockTraceReader::loadBlock(uint64_t block)
+{
+	unsigned char blockHeader[TRACE_V2_BLOCK_HEADER_BYTES];
+
+	readAt(blockOffsets[block], blockHeader, TRACE_V2_BLOCK_HEADER_BYTES);
+	uint64_t compressedBytes = readLittleEndian(blockHeader, 4);
+	uLongf rawBytes = readLittleEndian(blockHeader + 4, 4);
+
+	compressed.resize(compressedBytes);
+	payload.resize(rawBytes);
+	readAt(blockOffsets[block] + TRACE_V2_BLOCK_HEADER_BYTES, compressed.data(), compressedBytes);
+	if (uncompress(payload.data(), &rawBytes, compressed.data(), compressedBytes) != Z_OK || rawBytes != payload.size())
+	{
+		ERROR("== Error - Block "<<block<<" of trace file '"<<filename<<"' is corrupt");
+		exit(-1);
+	}
+
+	currentBlock = block;
+	nextBlock = block + 1;
+	payloadOffset = 0;
+	recordsLeftInBlock = readLittleEndian(blockHeader + 8, 4);
+	previousAddress = 0;
+}
+
+bool BlockTraceReader::nextRecord(TraceRecord &record)
+{
+	uint64_t gapAndType, zigzag;
+
+	while (recordsLeftInBlock == 0)
+	{
+		if (nextBlock >= blockOffsets.size())
+		{
+			return false;
+		}
+		loadBlock(nextBlock);
+	}
+
+	if (!readVarint(payload, payloadOffset, gapAndType) || !readVarint(payload, payloadOffset, zigzag))
+	{
+		ERROR("== Error - Block "<<currentBlock<<" of trace file '"<<filename<<"' ends in the middle of a record");
+		exit(-1);
+	}
+	recordsLeftInBlock--;
+
+	record.gap = gapAndType >> 1;
+	record.isRead = (gapAndType & 1) == 1;
+	previousAddress += (zigzag >> 1) ^ -(zigzag & 1);
+	record.address = previousAddress;
+	return true;
+}
+
+bool BlockTraceReader::seek(uint64_t recordNumber)
+{
+	if (recordNumber > numRecords)
+	{
+		return false;
+	}
+	//find the last block that starts at or before the record and decode forward from there
+	vector<uint64_t>::iterator it = upper_bound(blockFirstRecords.begin(), blockFirstRecords.end(), recordNumber);
+	if (it == blockFirstRecords.begin())
+	{
+		return recordNumber == 0;
+	}
+	uint64_t block = (it - blockFirstRecords.begin()) - 1;
+	loadBlock(block);
+
+	TraceRecord record;
+	for (uint64_t i=blockFirstRecords[block]; i<recordNumber; i++)
+	{
+		nextRecord(record);
+	}
+	return true;
+}
+
+} // namespace DRAMSim
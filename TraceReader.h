@@ -0,0 +1,180 @@
+/*********************************************************************************
+*  Copyright (c) 2010-2011, Elliott Cooper-Balis
+*                             Paul Rosenfeld
+*                             Bruce Jacob
+*                             University of Maryland 
+*                             dramninjas [at] gmail [dot] com
+*  All rights reserved.
+*  
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions are met:
+*  
+*     * Redistributions of source code must retain the above copyright notice,
+*        this list of conditions and the following disclaimer.
+*  
+*     * Redistributions in binary form must reproduce the above copyright notice,
+*        this list of conditions and the following disclaimer in the documentation
+*        and/or other materials provided with the distribution.
+*  
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+*  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+*  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+*  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+*  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+
+
+#ifndef TRACEREADER_H
+#define TRACEREADER_H
+
+//TraceReader.h
+//
+//Header file for the trace reader objects that feed TraceBasedSim
+//
+
+#include "SystemConfiguration.h"
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+//v2 block trace container (all integers little endian):
+//
+//  header : "HMTRACE2", uint32 version, uint32 records per block
+//  block  : uint32 compressed bytes, uint32 raw bytes, uint32 records,
+//           zlib compressed payload
+//  index  : per block a uint64 file offset and uint64 number of its first record
+//  footer : uint64 index offset, uint64 blocks, uint64 records, "HMTRIDX2"
+//
+//The payload holds varint(gap<<1 | isRead) followed by the zigzag varint
+//  of the address delta for every record. The address delta restarts from 0
+//  at the beginning of each block so that every block decodes on its own.
+#define TRACE_V2_MAGIC "HMTRACE2"
+#define TRACE_V2_INDEX_MAGIC "HMTRIDX2"
+#define TRACE_V2_MAGIC_BYTES 8
+#define TRACE_V2_VERSION 2
+#define TRACE_V2_HEADER_BYTES 16
+#define TRACE_V2_BLOCK_HEADER_BYTES 12
+#define TRACE_V2_INDEX_ENTRY_BYTES 16
+#define TRACE_V2_FOOTER_BYTES 32
+
+namespace DRAMSim
+{
+//one request of the trace, independent of the on-disk format
+struct TraceRecord
+{
+	uint64_t address;
+	bool isRead;
+	//cpu cycles between this request and the next one
+	uint64_t gap;
+};
+
+//A trace reader hands out the trace records one at a time so that the
+//  trace never has to be resident in memory all at once
+class TraceReader
+{
+public:
+	virtual ~TraceReader() {}
+	//returns false once the trace has been exhausted
+	virtual bool nextRecord(TraceRecord &record) = 0;
+	//positions the reader so that the next record returned is recordNumber,
+	//  returns false if the trace is shorter than that
+	virtual bool seek(uint64_t recordNumber);
+
+	//picks the reader that matches the format of the file
+	static TraceReader *open(const std::string &filename);
+	//unpacks one record of the legacy fixed-width 64-bit format
+	static void decodeLegacyRecord(int64_t raw, TraceRecord &record);
+};
+
+//Maps the trace file a window at a time; consumed windows are unmapped so the
+//  resident set stays flat regardless of the size of the trace
+class MmapTraceReader : public TraceReader
+{
+public:
+	MmapTraceReader(const std::string &filename);
+	virtual ~MmapTraceReader();
+	bool nextRecord(TraceRecord &record);
+	bool seek(uint64_t recordNumber);
+
+private:
+	void mapWindow(uint64_t start);
+	void unmapWindow();
+
+	int fd;
+	uint64_t fileSize;
+	uint64_t windowSize;
+	//file offset and address of the currently mapped window
+	uint64_t windowStart;
+	uint64_t windowEnd;
+	const char *window;
+	//file offset of the next record
+	uint64_t offset;
+};
+
+//Pulls legacy records from a file descriptor a fixed-size chunk at a time,
+//  inflating gzip traces on the fly. Works on pipes and stdin, where neither
+//  the length of the trace nor the ability to rewind it can be assumed
+class StreamTraceReader : public TraceReader
+{
+public:
+	//prefix holds the bytes already consumed from fd to sniff the format
+	StreamTraceReader(const std::string &filename, int fd, const unsigned char *prefix, size_t prefixBytes);
+	virtual ~StreamTraceReader();
+	bool nextRecord(TraceRecord &record);
+
+private:
+	bool refill();
+	void readInput();
+
+	std::string filename;
+	int fd;
+	bool compressed;
+	z_stream zstream;
+	//true between the header and the trailer of a gzip member
+	bool midStream;
+	bool inputDone;
+	std::vector<unsigned char> input;
+	//inflated bytes, [outputStart, outputEnd) have not been decoded yet
+	std::vector<unsigned char> output;
+	size_t outputStart;
+	size_t outputEnd;
+};
+
+//Reads the v2 block container; only the block being replayed is held
+//  decompressed, and the footer index lets a run start at any record
+class BlockTraceReader : public TraceReader
+{
+public:
+	BlockTraceReader(const std::string &filename);
+	virtual ~BlockTraceReader();
+	bool nextRecord(TraceRecord &record);
+	bool seek(uint64_t recordNumber);
+
+private:
+	void readAt(uint64_t fileOffset, void *dest, uint64_t length);
+	void loadBlock(uint64_t block);
+
+	std::string filename;
+	int fd;
+	uint64_t numRecords;
+	std::vector<uint64_t> blockOffsets;
+	std::vector<uint64_t> blockFirstRecords;
+	//the decompressed payload of the current block
+	uint64_t currentBlock;
+	uint64_t nextBlock;
+	std::vector<unsigned char> compressed;
+	std::vector<unsigned char> payload;
+	size_t payloadOffset;
+	uint64_t recordsLeftInBlock;
+	uint64_t previousAddress;
+};
+}
+
+#endif
+
@@ -0,0 +1,175 @@
+/*********************************************************************************
+*  Copyright (c) 2010-2011, Elliott Cooper-Balis
+*                             Paul Rosenfeld
+*                             Bruce Jacob
+*                             University of Maryland 
+*                             dramninjas [at] gmail [dot] com
+*  All rights reserved.
+*  
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions are met:
+*  
+*     * Redistributions of source code must retain the above copyright notice,
+*        this list of conditions and the following disclaimer.
+*  
+*     * Redistributions in binary form must reproduce the above copyright notice,
+*        this list of conditions and the following disclaimer in the documentation
+*        and/or other materials provided with the distribution.
+*  
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+*  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+*  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+*  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+*  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+
+
+
+
+//TraceWriter.cpp
+//
+//Class file for the writer of the v2 block trace container
+//
+
+#include "TraceWriter.h"
+#include <zlib.h>
+
+using namespace std;
+
+namespace DRAMSim
+{
+
+BlockTraceWriter::BlockTraceWriter(const string &filename_, unsigned recordsPerBlock_) :
+	filename(filename_),
+	recordsPerBlock(recordsPerBlock_),
+	closed(false),
+	numRecords(0),
+	bytesWritten(0),
+	recordsInBlock(0),
+	previousAddress(0)
+{
+	out.open(filename.c_str(), ios_base::out | ios_base::binary | ios_base::trunc);
+	if (!out.is_open())
+	{
+		ERROR("== Error - Could not open '"<<filename<<"' for writing");
+		exit(-1);
+	}
+	writeBytes(TRACE_V2_MAGIC, TRACE_V2_MAGIC_BYTES);
+	writeLittleEndian(TRACE_V2_VERSION, 4);
+	writeLittleEndian(recordsPerBlock, 4);
+}
+
+BlockTraceWriter::~BlockTraceWriter()
+{
+	close();
+}
+
+void BlockTraceWriter::addRecord(const TraceRecord &record)
+{
+	//the type rides in the low bit of the gap, the address is stored as a zigzag delta
+	writeVarint((record.gap << 1) | (record.isRead ? 1 : 0));
+	int64_t delta = (int64_t)(record.address - previousAddress);
+	writeVarint(((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+	previousAddress = record.address;
+
+	recordsInBlock++;
+	numRecords++;
+	if (recordsInBlock == recordsPerBlock)
+	{
+		flushBlock();
+	}
+}
+
+void BlockTraceWriter::flushBlock()
+{
+	if (recordsInBlock == 0)
+	{
+		return;
+	}
+	uLongf compressedBytes = compressBound(payload.size());
+	compressed.resize(compressedBytes);
+	if (compress2(compressed.data(), &compressedBytes, payload.data(), payload.size(), Z_BEST_COMPRESSION) != Z_OK)
+	{
+		ERROR("== Error - Could not compress block "<<blockOffsets.size()<<" of '"<<filename<<"'");
+		exit(-1);
+	}
+
+	blockOffsets.push_back(bytesWritten);
+	blockFirstRecords.push_back(numRecords - recordsInBlock);
+	writeLittleEndian(compressedBytes, 4);
+	writeLittleEndian(payload.size(), 4);
+	writeLittleEndian(recordsInBlock, 4);
+	writeBytes(compressed.data(), compressedBytes);
+
+	//each block starts from a clean delta state so it can be decoded on its own
+	payload.clear();
+	recordsInBlock = 0;
+	previousAddress = 0;
+}
+
+void BlockTraceWriter::close()
+{
+	if (closed)
+	{
+		return;
+	}
+	flushBlock();
+
+	uint64_t indexOffset = bytesWritten;
+	for (size_t i=0; i<blockOffsets.size(); i++)
+	{
+		writeLittleEndian(blockOffsets[i], 8);
+		writeLittleEndian(blockFirstRecords[i], 8);
+	}
+	writeLittleEndian(indexOffset, 8);
+	writeLittleEndian(blockOffsets.size(), 8);
+	writeLittleEndian(numRecords, 8);
+	writeBytes(TRACE_V2_INDEX_MAGIC, TRACE_V2_MAGIC_BYTES);
+
+	out.close();
+	if (out.fail())
+	{
+		ERROR("== Error - Could not finish writing '"<<filename<<"'");
+		exit(-1);
+	}
+	closed = true;
+}
+
+void BlockTraceWriter::writeVarint(uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		payload.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	payload.push_back((unsigned char)value);
+}
+
+void BlockTraceWriter::writeLittleEndian(uint64_t value, unsigned numBytes)
+{
+	unsigned char bytes[8];
+	for (unsigned i=0; i<numBytes; i++)
+	{
+		bytes[i] = (unsigned char)(value >> (8*i));
+	}
+	writeBytes(bytes, numBytes);
+}
+
+void BlockTraceWriter::writeBytes(const void *data, uint64_t length)
+{
+	out.write((const char *)data, length);
+	if (out.fail())
+	{
+		ERROR("== Error - Could not write to '"<<filename<<"'");
+		exit(-1);
+	}
+	bytesWritten += length;
+}
+
+} // namespace DRAMSim
@@ -0,0 +1,85 @@
+/*********************************************************************************
+*  Copyright (c) 2010-2011, Elliott Cooper-Balis
+*                             Paul Rosenfeld
+*                             Bruce Jacob
+*                             University of Maryland 
+*                             dramninjas [at] gmail [dot] com
+*  All rights reserved.
+*  
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions are met:
+*  
+*     * Redistributions of source code must retain the above copyright notice,
+*        this list of conditions and the following disclaimer.
+*  
+*     * Redistributions in binary form must reproduce the above copyright notice,
+*        this list of conditions and the following disclaimer in the documentation
+*        and/or other materials provided with the distribution.
+*  
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+*  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+*  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+*  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+*  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+
+
+#ifndef TRACEWRITER_H
+#define TRACEWRITER_H
+
+//TraceWriter.h
+//
+//Header file for the writer of the v2 block trace container
+//
+
+#include "TraceReader.h"
+#include <fstream>
+
+//default number of records per independently compressed block
+#define TRACE_V2_BLOCK_RECORDS 65536
+
+namespace DRAMSim
+{
+//Encodes records into the v2 container described in TraceReader.h; close()
+//  must be called for the block index to be written
+class BlockTraceWriter
+{
+public:
+	BlockTraceWriter(const std::string &filename, unsigned recordsPerBlock=TRACE_V2_BLOCK_RECORDS);
+	virtual ~BlockTraceWriter();
+	void addRecord(const TraceRecord &record);
+	void close();
+
+	uint64_t getNumRecords() { return numRecords; }
+	uint64_t getBytesWritten() { return bytesWritten; }
+
+private:
+	void flushBlock();
+	void writeVarint(uint64_t value);
+	void writeLittleEndian(uint64_t value, unsigned numBytes);
+	void writeBytes(const void *data, uint64_t length);
+
+	std::string filename;
+	std::ofstream out;
+	unsigned recordsPerBlock;
+	bool closed;
+	uint64_t numRecords;
+	uint64_t bytesWritten;
+	//the block currently being filled
+	std::vector<unsigned char> payload;
+	std::vector<unsigned char> compressed;
+	unsigned recordsInBlock;
+	uint64_t previousAddress;
+	std::vector<uint64_t> blockOffsets;
+	std::vector<uint64_t> blockFirstRecords;
+};
+}
+
+#endif
+
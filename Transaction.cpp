@@ -45,16 +45,36 @@ namespace DRAMSim {
 
 Transaction::Transaction(TransactionType transType, uint64_t addr, void *dat) :
 	transactionType(transType),
+	rank(0),
+	bank(0),
+	column(0),
+	id(0),
 	address(addr),
-	data(dat)
+	row(0),
+	channel(0),
+	source(0),
+	mapped(0)
+#ifndef NO_STORAGE
+	, data(dat)
+#endif
 {}
 
 Transaction::Transaction(const Transaction &t)
 	: transactionType(t.transactionType)
+	  , rank(t.rank)
+	  , bank(t.bank)
+	  , column(t.column)
+	  , id(t.id)
 	  , address(t.address)
-	  , data(NULL)
 	  , timeAdded(t.timeAdded)
+	  , row(t.row)
+	  , channel(t.channel)
+	  , source(t.source)
+	  , mapped(t.mapped)
+#ifndef NO_STORAGE
+	  , data(NULL)
 	  , timeReturned(t.timeReturned)
+#endif
 {
 	#ifndef NO_STORAGE
 	ERROR("Data storage is really outdated and these copies happen in an \n improper way, which will eventually cause problems. Please send an \n email to dramninjas [at] gmail [dot] com if you need data storage");
@@ -70,11 +90,11 @@ ostream &operator<<(ostream &os, const Transaction &t)
 	}
 	else if (t.transactionType == DATA_WRITE)
 	{
-		os<<"T [Write] [0x" << hex << t.address << "] [" << dec << t.data << "]" <<endl;
+		os<<"T [Write] [0x" << hex << t.address << "] [" << dec << t.getData() << "]" <<endl;
 	}
 	else if (t.transactionType == RETURN_DATA)
 	{
-		os<<"T [Data] [0x" << hex << t.address << "] [" << dec << t.data << "]" <<endl;
+		os<<"T [Data] [0x" << hex << t.address << "] [" << dec << t.getData() << "]" <<endl;
 	}
 	return os; 
 }
@@ -38,6 +38,7 @@
 #include "SystemConfiguration.h"
 #include "BusPacket.h"
 #include "IniReader.h"
+#include "AddressMapping.h"
 
 using std::ostream; 
 
@@ -55,11 +56,24 @@ class Transaction
 	Transaction();
 public:
 	//fields
-	TransactionType transactionType;
+	TransactionType transactionType : 4;
+	//where address maps to, valid once mapped is set
+	unsigned rank : BUSPACKET_RANK_BITS;
+	unsigned bank : BUSPACKET_BANK_BITS;
+	unsigned column : BUSPACKET_COLUMN_BITS;
+	//unique within the channel, handed out when the channel accepts the transaction
+	uint32_t id;
 	uint64_t address;
-	void *data;
 	uint64_t timeAdded;
+	unsigned row;
+	unsigned channel : 23;
+	//who made the request, for the schedulers that share a channel out fairly
+	unsigned source : BUSPACKET_SOURCE_BITS;
+	unsigned mapped : 1;
+#ifndef NO_STORAGE
+	void *data;
 	uint64_t timeReturned;
+#endif
 
 
 	friend ostream &operator<<(ostream &os, const Transaction &t);
@@ -67,6 +81,27 @@ public:
 	Transaction(TransactionType transType, uint64_t addr, void *data);
 	Transaction(const Transaction &t);
 
+	//caches the result of AddressMapping::decode() for address
+	void setMapping(const DecodedAddress &decoded)
+	{
+		channel = decoded.channel;
+		rank = decoded.rank;
+		bank = decoded.bank;
+		row = decoded.row;
+		column = decoded.column;
+		mapped = 1;
+	}
+
+	//NULL without storage
+	void *getData() const
+	{
+#ifndef NO_STORAGE
+		return data;
+#else
+		return NULL;
+#endif
+	}
+
 	BusPacketType getBusPacketType(unsigned systemID,IniReader *iniReader)
 	{
 		switch (transactionType)
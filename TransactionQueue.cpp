@@ -0,0 +1,94 @@
+/*********************************************************************************
+*  Copyright (c) 2010-2011, Elliott Cooper-Balis
+*                             Paul Rosenfeld
+*                             Bruce Jacob
+*                             University of Maryland 
+*                             dramninjas [at] gmail [dot] com
+*  All rights reserved.
+*  
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions are met:
+*  
+*     * Redistributions of source code must retain the above copyright notice,
+*        this list of conditions and the following disclaimer.
+*  
+*     * Redistributions in binary form must reproduce the above copyright notice,
+*        this list of conditions and the following disclaimer in the documentation
+*        and/or other materials provided with the distribution.
+*  
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+*  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+*  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+*  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+*  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+
+
+//TransactionQueue.cpp
+//
+//Class file for the queue of transactions waiting for the command queue
+//
+
+#include "TransactionQueue.h"
+
+using namespace std;
+
+namespace DRAMSim
+{
+
+TransactionQueue::TransactionQueue(unsigned numRanks, unsigned numBanks_, size_t depth) :
+	numBanks(numBanks_),
+	queue(depth),
+	bankQueues(numRanks*numBanks_, RingBuffer<Handle>(depth)),
+	pending((numRanks*numBanks_+63)/64, 0)
+{
+}
+
+void TransactionQueue::push_back(Transaction *trans)
+{
+	unsigned i = trans->rank*numBanks + trans->bank;
+	bankQueues[i].push_back(queue.push_back(trans));
+	pending[i/64] |= 1ULL << (i%64);
+}
+
+Transaction *TransactionQueue::popOldest(const vector<uint64_t> &ready)
+{
+	unsigned oldestBank = 0;
+	Handle oldest = queue.end();
+	for (size_t word=0; word<pending.size(); word++)
+	{
+		uint64_t bits = pending[word] & ready[word];
+		while (bits != 0)
+		{
+			unsigned i = word*64 + __builtin_ctzll(bits);
+			bits &= bits - 1;
+			if (bankQueues[i].front() < oldest)
+			{
+				oldest = bankQueues[i].front();
+				oldestBank = i;
+			}
+		}
+	}
+	if (oldest == queue.end())
+	{
+		return NULL;
+	}
+
+	Transaction *trans = queue[oldest];
+	queue.erase(oldest);
+	RingBuffer<Handle> &bankQueue = bankQueues[oldestBank];
+	bankQueue.pop_front();
+	if (bankQueue.size() == 0)
+	{
+		pending[oldestBank/64] &= ~(1ULL << (oldestBank%64));
+	}
+	return trans;
+}
+
+}
@@ -0,0 +1,100 @@
+/*********************************************************************************
+*  Copyright (c) 2010-2011, Elliott Cooper-Balis
+*                             Paul Rosenfeld
+*                             Bruce Jacob
+*                             University of Maryland 
+*                             dramninjas [at] gmail [dot] com
+*  All rights reserved.
+*  
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions are met:
+*  
+*     * Redistributions of source code must retain the above copyright notice,
+*        this list of conditions and the following disclaimer.
+*  
+*     * Redistributions in binary form must reproduce the above copyright notice,
+*        this list of conditions and the following disclaimer in the documentation
+*        and/or other materials provided with the distribution.
+*  
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+*  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+*  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+*  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+*  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+
+#ifndef TRANSACTIONQUEUE_H
+#define TRANSACTIONQUEUE_H
+
+//TransactionQueue.h
+//
+//Header file for the queue of transactions waiting for the command queue
+//
+
+#include "SystemConfiguration.h"
+#include "Transaction.h"
+#include "RingBuffer.h"
+#include <vector>
+
+namespace DRAMSim
+{
+//Transactions a channel has accepted but not yet broken into commands, kept
+//  in arrival order and also filed by the (rank, bank) they map to.
+//
+//Each bank keeps the handles of its own transactions, oldest first, and a
+//  bitmap records which banks have any. Handles are handed out in arrival
+//  order, so the oldest transaction to any of a set of banks is found by
+//  bit-scanning the banks in the set and comparing their front handles,
+//  without looking at the transactions queued behind them.
+//
+//Banks are numbered rank*numBanks+bank in the bitmaps.
+class TransactionQueue
+{
+public:
+	typedef RingBuffer<Transaction *>::Handle Handle;
+
+	TransactionQueue(unsigned numRanks, unsigned numBanks_, size_t depth);
+	//trans must already carry its rank and bank
+	void push_back(Transaction *trans);
+	//takes out the oldest transaction to a bank whose bit is set in ready,
+	//  NULL if none of those banks has any
+	Transaction *popOldest(const std::vector<uint64_t> &ready);
+	size_t size() const
+	{
+		return queue.size();
+	}
+
+	//queued transactions, oldest first; for printing and teardown
+	Handle begin() const
+	{
+		return queue.begin();
+	}
+	Handle end() const
+	{
+		return queue.end();
+	}
+	Handle next(Handle h) const
+	{
+		return queue.next(h);
+	}
+	Transaction *operator[](Handle h)
+	{
+		return queue[h];
+	}
+
+private:
+	unsigned numBanks;
+	RingBuffer<Transaction *> queue;
+	std::vector< RingBuffer<Handle> > bankQueues;
+	//one bit per bank with a non-empty bank queue
+	std::vector<uint64_t> pending;
+};
+}
+
+#endif
@@ -0,0 +1,137 @@
+/*********************************************************************************
+*  Copyright (c) 2010-2011, Elliott Cooper-Balis
+*                             Paul Rosenfeld
+*                             Bruce Jacob
+*                             University of Maryland 
+*                             dramninjas [at] gmail [dot] com
+*  All rights reserved.
+*  
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions are met:
+*  
+*     * Redistributions of source code must retain the above copyright notice,
+*        this list of conditions and the following disclaimer.
+*  
+*     * Redistributions in binary form must reproduce the above copyright notice,
+*        this list of conditions and the following disclaimer in the documentation
+*        and/or other materials provided with the distribution.
+*  
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+*  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+*  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+*  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+*  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+
+//TransactionTable.cpp
+//
+//Class file for the table of transactions a channel has outstanding
+//
+
+#include "TransactionTable.h"
+
+using namespace std;
+
+namespace DRAMSim
+{
+
+TransactionTable::TransactionTable(size_t capacity_) :
+	count(0)
+{
+	size_t capacity = 1;
+	while (capacity < capacity_)
+	{
+		capacity <<= 1;
+	}
+	slots.resize(capacity, NULL);
+	mask = capacity - 1;
+}
+
+//slot holding id, or the empty slot that ends its probe sequence
+size_t TransactionTable::findSlot(uint32_t id)
+{
+	size_t i = id & mask;
+	while (slots[i] != NULL && slots[i]->id != id)
+	{
+		i = (i + 1) & mask;
+	}
+	return i;
+}
+
+void TransactionTable::insert(Transaction *trans)
+{
+	if (2 * (count + 1) > slots.size())
+	{
+		grow();
+	}
+	size_t i = findSlot(trans->id);
+	if (slots[i] != NULL)
+	{
+		ERROR("== Error - Transaction "<<trans->id<<" is already outstanding");
+		abort();
+	}
+	slots[i] = trans;
+	count++;
+}
+
+Transaction *TransactionTable::find(uint32_t id)
+{
+	return slots[findSlot(id)];
+}
+
+Transaction *TransactionTable::remove(uint32_t id)
+{
+	size_t i = findSlot(id);
+	Transaction *trans = slots[i];
+	if (trans == NULL)
+	{
+		return NULL;
+	}
+	slots[i] = NULL;
+	count--;
+
+	//shift the rest of the probe run back so that no entry is left behind
+	//  the hole, which saves having to mark deleted slots
+	size_t j = i;
+	while (true)
+	{
+		j = (j + 1) & mask;
+		if (slots[j] == NULL)
+		{
+			break;
+		}
+		size_t home = slots[j]->id & mask;
+		//the entry at j can move into the hole at i unless its home slot
+		//  lies cyclically in (i, j]
+		if ((j > i && (home <= i || home > j)) || (j < i && home <= i && home > j))
+		{
+			slots[i] = slots[j];
+			slots[j] = NULL;
+			i = j;
+		}
+	}
+	return trans;
+}
+
+void TransactionTable::grow()
+{
+	vector<Transaction *> old;
+	old.swap(slots);
+	slots.resize(old.size() * 2, NULL);
+	mask = slots.size() - 1;
+	for (size_t i=0; i<old.size(); i++)
+	{
+		if (old[i] != NULL)
+		{
+			size_t j = findSlot(old[i]->id);
+			slots[j] = old[i];
+		}
+	}
+}
+}
@@ -0,0 +1,85 @@
+/*********************************************************************************
+*  Copyright (c) 2010-2011, Elliott Cooper-Balis
+*                             Paul Rosenfeld
+*                             Bruce Jacob
+*                             University of Maryland 
+*                             dramninjas [at] gmail [dot] com
+*  All rights reserved.
+*  
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions are met:
+*  
+*     * Redistributions of source code must retain the above copyright notice,
+*        this list of conditions and the following disclaimer.
+*  
+*     * Redistributions in binary form must reproduce the above copyright notice,
+*        this list of conditions and the following disclaimer in the documentation
+*        and/or other materials provided with the distribution.
+*  
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+*  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+*  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+*  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+*  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#ifndef TRANSACTIONTABLE_H
+#define TRANSACTIONTABLE_H
+
+//TransactionTable.h
+//
+//Header file for the table of transactions a channel has outstanding
+//
+
+#include "SystemConfiguration.h"
+#include "Transaction.h"
+#include <vector>
+
+namespace DRAMSim
+{
+//Outstanding transactions indexed by their id, so that a completion finds
+//  exactly the request it belongs to in O(1) even when several requests to
+//  the same line are in flight.
+//
+//Open addressing with linear probing; ids are handed out sequentially so
+//  they hash to consecutive slots and rarely collide. The table doubles
+//  whenever it gets half full.
+class TransactionTable
+{
+public:
+	TransactionTable(size_t capacity_ = 16);
+	void insert(Transaction *trans);
+	//NULL if no transaction with that id is outstanding
+	Transaction *find(uint32_t id);
+	//takes the transaction out of the table, NULL if there is none
+	Transaction *remove(uint32_t id);
+	size_t size() const
+	{
+		return count;
+	}
+	//every slot, empty ones are NULL; for walking the whole table
+	size_t getNumSlots() const
+	{
+		return slots.size();
+	}
+	Transaction *getSlot(size_t i) const
+	{
+		return slots[i];
+	}
+
+private:
+	size_t findSlot(uint32_t id);
+	void grow();
+
+	std::vector<Transaction *> slots;
+	size_t mask;
+	size_t count;
+};
+}
+
+#endif
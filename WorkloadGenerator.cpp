@@ -0,0 +1,389 @@
+/*********************************************************************************
+*  Copyright (c) 2010-2011, Elliott Cooper-Balis
+*                             Paul Rosenfeld
+*                             Bruce Jacob
+*                             University of Maryland 
+*                             dramninjas [at] gmail [dot] com
+*  All rights reserved.
+*  
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions are met:
+*  
+*     * Redistributions of source code must retain the above copyright notice,
+*        this list of conditions and the following disclaimer.
+*  
+*     * Redistributions in binary form must reproduce the above copyright notice,
+*        this list of conditions and the following disclaimer in the documentation
+*        and/or other materials provided with the distribution.
+*  
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+*  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+*  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+*  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+*  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+
+
+
+
+//WorkloadGenerator.cpp
+//
+//Class file for the synthetic workload generator
+//
+
+#include "WorkloadGenerator.h"
+#include <math.h>
+#include <stdlib.h>
+
+//multiplier that scatters the zipf ranks over the working set
+#define ZIPF_SCATTER 2654435761ULL
+
+using namespace std;
+
+namespace DRAMSim
+{
+
+static const char *patternNames[] = {"seq", "stride", "random", "zipf", "chase"};
+static const char *streamKeys[] = {"pattern", "requests", "rate", "arrival", "reads", "nvm", "footprint", "base", "stride", "zipf"};
+
+static string getParam(const IniReader::OverrideMap &params, const string &key, const string &defaultValue)
+{
+	IniReader::OverrideIterator it = params.find(key);
+	return it == params.end() ? defaultValue : it->second;
+}
+
+static double getDoubleParam(const IniReader::OverrideMap &params, const string &key, double defaultValue)
+{
+	IniReader::OverrideIterator it = params.find(key);
+	return it == params.end() ? defaultValue : atof(it->second.c_str());
+}
+
+static uint64_t getUnsignedParam(const IniReader::OverrideMap &params, const string &key, uint64_t defaultValue)
+{
+	IniReader::OverrideIterator it = params.find(key);
+	return it == params.end() ? defaultValue : strtoull(it->second.c_str(), NULL, 10);
+}
+
+WorkloadStream::WorkloadStream(unsigned id_, const IniReader::OverrideMap &params, uint64_t seed, uint64_t dramBytes, uint64_t nvmBytes) :
+	id(id_),
+	pattern(PATTERN_SEQUENTIAL),
+	nextArrival(0),
+	waiting(false),
+	numIssued(0),
+	numReads(0),
+	numNvm(0)
+{
+	for (IniReader::OverrideIterator it = params.begin(); it != params.end(); it++)
+	{
+		bool known = false;
+		for (size_t i=0; i<sizeof(streamKeys)/sizeof(streamKeys[0]); i++)
+		{
+			known = known || it->first == streamKeys[i];
+		}
+		if (!known)
+		{
+			ERROR("Unknown workload stream parameter '"<<it->first<<"'");
+			exit(-1);
+		}
+	}
+
+	string patternName = getParam(params, "pattern", "seq");
+	bool found = false;
+	for (unsigned i=0; i<sizeof(patternNames)/sizeof(patternNames[0]); i++)
+	{
+		if (patternName == patternNames[i])
+		{
+			pattern = (WorkloadPattern)i;
+			found = true;
+		}
+	}
+	if (!found)
+	{
+		ERROR("Unknown workload pattern '"<<patternName<<"', expected seq, stride, random, zipf or chase");
+		exit(-1);
+	}
+
+	numRequests = getUnsignedParam(params, "requests", 100000);
+	rate = getDoubleParam(params, "rate", 0.1);
+	poissonArrivals = getParam(params, "arrival", "fixed") == "poisson";
+	//a pointer chase only ever reads
+	readFraction = pattern == PATTERN_CHASE ? 1.0 : getDoubleParam(params, "reads", 0.7);
+	nvmFraction = getDoubleParam(params, "nvm", 0.0);
+	stride = getUnsignedParam(params, "stride", pattern == PATTERN_STRIDED ? 4096 : WORKLOAD_LINE_BYTES);
+	zipfTheta = getDoubleParam(params, "zipf", 0.99);
+	uint64_t footprint = getUnsignedParam(params, "footprint", 64) << 20;
+	uint64_t base = getUnsignedParam(params, "base", 0) << 20;
+
+	if (rate <= 0 || readFraction < 0 || readFraction > 1 || nvmFraction < 0 || nvmFraction > 1)
+	{
+		ERROR("Workload stream "<<id<<" needs rate > 0 and reads, nvm in [0,1]");
+		exit(-1);
+	}
+	if (pattern == PATTERN_ZIPF && (zipfTheta <= 0 || zipfTheta >= 1))
+	{
+		ERROR("Workload stream "<<id<<" needs a zipf exponent in (0,1)");
+		exit(-1);
+	}
+	if (footprint < WORKLOAD_LINE_BYTES || stride == 0 || stride % WORKLOAD_LINE_BYTES != 0)
+	{
+		ERROR("Workload stream "<<id<<" needs a footprint of at least one line and a stride that is a multiple of "<<WORKLOAD_LINE_BYTES);
+		exit(-1);
+	}
+
+	//the two tiers are laid out back to back, just like findChannelNumber expects
+	uint64_t tierBytes[2] = {dramBytes, nvmBytes};
+	tierBase[0] = base;
+	tierBase[1] = dramBytes + base;
+	for (unsigned tier=0; tier<2; tier++)
+	{
+		bool used = tier == 0 ? nvmFraction < 1 : nvmFraction > 0;
+		if (used && base + footprint > tierBytes[tier])
+		{
+			ERROR("Workload stream "<<id<<" does not fit into the "<<(tier == 0 ? "DRAM" : "NVM")<<" tier ("<<(tierBytes[tier]>>20)<<"MB)");
+			exit(-1);
+		}
+		tierLines[tier] = footprint / WORKLOAD_LINE_BYTES;
+		cursor[tier] = 0;
+	}
+
+	seed_seq seeds = {seed, (uint64_t)id};
+	random.seed(seeds);
+
+	for (unsigned tier=0; tier<2; tier++)
+	{
+		bool used = tier == 0 ? nvmFraction < 1 : nvmFraction > 0;
+		if (used && pattern == PATTERN_ZIPF)
+		{
+			initZipf(tier);
+		}
+		else if (used && pattern == PATTERN_CHASE)
+		{
+			initChase(tier);
+		}
+	}
+}
+
+//53 random bits in [0,1); the std distributions are not reproducible across libraries
+double WorkloadStream::nextUniform()
+{
+	return (random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//constants of the zipf sampler of Gray et al., "Quickly generating billion-record synthetic databases"
+void WorkloadStream::initZipf(unsigned tier)
+{
+	uint64_t n = tierLines[tier];
+	double zetan = 0;
+	for (uint64_t i=1; i<=n; i++)
+	{
+		zetan += 1.0 / pow((double)i, zipfTheta);
+	}
+	double zeta2 = 1.0 + pow(0.5, zipfTheta);
+	zipfZetan[tier] = zetan;
+	zipfEta[tier] = n < 2 ? 0 : (1.0 - pow(2.0 / n, 1.0 - zipfTheta)) / (1.0 - zeta2 / zetan);
+}
+
+//Sattolo's shuffle yields a single cycle, so the chase visits every line of the working set
+void WorkloadStream::initChase(unsigned tier)
+{
+	uint64_t n = tierLines[tier];
+	if (n > UINT32_MAX)
+	{
+		ERROR("Workload stream "<<id<<" has too large a footprint for a pointer chase");
+		exit(-1);
+	}
+	chaseNext[tier].resize(n);
+	for (uint64_t i=0; i<n; i++)
+	{
+		chaseNext[tier][i] = i;
+	}
+	for (uint64_t i=n-1; i>0; i--)
+	{
+		swap(chaseNext[tier][i], chaseNext[tier][random() % i]);
+	}
+}
+
+uint64_t WorkloadStream::nextLine(unsigned tier)
+{
+	uint64_t n = tierLines[tier];
+	uint64_t line = 0;
+
+	switch (pattern)
+	{
+	case PATTERN_SEQUENTIAL:
+	case PATTERN_STRIDED:
+		line = cursor[tier];
+		cursor[tier] = (cursor[tier] + stride / WORKLOAD_LINE_BYTES) % n;
+		break;
+	case PATTERN_RANDOM:
+		line = random() % n;
+		break;
+	case PATTERN_ZIPF:
+		{
+			double u = nextUniform();
+			double uz = u * zipfZetan[tier];
+			uint64_t rank;
+			if (uz < 1.0)
+			{
+				rank = 0;
+			}
+			else if (uz < 1.0 + pow(0.5, zipfTheta))
+			{
+				rank = 1;
+			}
+			else
+			{
+				rank = (uint64_t)(n * pow(zipfEta[tier] * u - zipfEta[tier] + 1.0, 1.0 / (1.0 - zipfTheta)));
+			}
+			//the hot lines would otherwise all sit in the same few rows
+			line = (min(rank, n - 1) * ZIPF_SCATTER) % n;
+		}
+		break;
+	case PATTERN_CHASE:
+		line = cursor[tier];
+		cursor[tier] = chaseNext[tier][line];
+		break;
+	}
+	return line;
+}
+
+bool WorkloadStream::isReady(uint64_t currentCycle)
+{
+	return !isDone() && !waiting && nextArrival <= currentCycle;
+}
+
+Transaction *WorkloadStream::generate()
+{
+	unsigned tier = nvmFraction > 0 && nextUniform() < nvmFraction ? 1 : 0;
+	bool isRead = nextUniform() < readFraction;
+	uint64_t address = tierBase[tier] + nextLine(tier) * WORKLOAD_LINE_BYTES;
+
+	if (poissonArrivals)
+	{
+		nextArrival += -log(1.0 - nextUniform()) / rate;
+	}
+	else
+	{
+		nextArrival += 1.0 / rate;
+	}
+	if (pattern == PATTERN_CHASE)
+	{
+		waiting = true;
+	}
+
+	numIssued++;
+	numReads += isRead ? 1 : 0;
+	numNvm += tier;
+	Transaction *trans = new Transaction(isRead ? DATA_READ : DATA_WRITE, address, NULL);
+	trans->source = id;
+	return trans;
+}
+
+void WorkloadStream::readComplete(uint64_t currentCycle)
+{
+	if (waiting)
+	{
+		waiting = false;
+		nextArrival = max(nextArrival, (double)currentCycle);
+	}
+}
+
+void WorkloadStream::printStats()
+{
+	cout<<"stream "<<id<<" ("<<patternNames[pattern]<<"): "<<numIssued<<" requests, "<<numReads<<" reads, "
+		<<numIssued-numReads<<" writes, "<<numNvm<<" to NVM"<<endl;
+}
+
+WorkloadGenerator::WorkloadGenerator(uint64_t seed_, uint64_t dramBytes_, uint64_t nvmBytes_) :
+	seed(seed_),
+	dramBytes(dramBytes_),
+	nvmBytes(nvmBytes_),
+	currentCycle(0)
+{
+}
+
+WorkloadGenerator::~WorkloadGenerator()
+{
+	for (size_t i=0; i<streams.size(); i++)
+	{
+		delete streams[i];
+	}
+}
+
+void WorkloadGenerator::addStream(const IniReader::OverrideMap &params)
+{
+	//each stream is a source of its own to the schedulers
+	if (streams.size() == (1U<<BUSPACKET_SOURCE_BITS))
+	{
+		ERROR("Can't have more than "<<(1U<<BUSPACKET_SOURCE_BITS)<<" workload streams");
+		exit(-1);
+	}
+	streams.push_back(new WorkloadStream(streams.size(), params, seed, dramBytes, nvmBytes));
+}
+
+Transaction *WorkloadGenerator::nextRequest(uint64_t currentCycle_)
+{
+	currentCycle = currentCycle_;
+
+	//ties go to the lower stream id so that the merge is deterministic
+	WorkloadStream *oldest = NULL;
+	for (size_t i=0; i<streams.size(); i++)
+	{
+		if (streams[i]->isReady(currentCycle) && (oldest == NULL || streams[i]->getNextCycle() < oldest->getNextCycle()))
+		{
+			oldest = streams[i];
+		}
+	}
+	if (oldest == NULL)
+	{
+		return NULL;
+	}
+	Transaction *trans = oldest->generate();
+	if (trans->transactionType == DATA_READ)
+	{
+		outstandingReads.insert(make_pair(trans->address, (unsigned)trans->source));
+	}
+	return trans;
+}
+
+bool WorkloadGenerator::isDone()
+{
+	for (size_t i=0; i<streams.size(); i++)
+	{
+		if (!streams[i]->isDone())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//the callback's cycle is in the memory clock domain while the streams keep
+//	their arrivals in cpu cycles, so the cpu cycle of the last request is used
+void WorkloadGenerator::readComplete(unsigned, uint64_t address, uint64_t)
+{
+	//equal keys keep their insertion order, so this is the oldest read
+	multimap<uint64_t, unsigned>::iterator read = outstandingReads.lower_bound(address);
+	if (read == outstandingReads.end() || read->first != address)
+	{
+		return;
+	}
+	streams[read->second]->readComplete(currentCycle);
+	outstandingReads.erase(read);
+}
+
+void WorkloadGenerator::printStats()
+{
+	for (size_t i=0; i<streams.size(); i++)
+	{
+		streams[i]->printStats();
+	}
+}
+
+} // namespace DRAMSim
@@ -0,0 +1,146 @@
+/*********************************************************************************
+*  Copyright (c) 2010-2011, Elliott Cooper-Balis
+*                             Paul Rosenfeld
+*                             Bruce Jacob
+*                             University of Maryland 
+*                             dramninjas [at] gmail [dot] com
+*  All rights reserved.
+*  
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions are met:
+*  
+*     * Redistributions of source code must retain the above copyright notice,
+*        this list of conditions and the following disclaimer.
+*  
+*     * Redistributions in binary form must reproduce the above copyright notice,
+*        this list of conditions and the following disclaimer in the documentation
+*        and/or other materials provided with the distribution.
+*  
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+*  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+*  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+*  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+*  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+
+
+#ifndef WORKLOADGENERATOR_H
+#define WORKLOADGENERATOR_H
+
+//WorkloadGenerator.h
+//
+//Header file for the synthetic workload generator that feeds TraceBasedSim
+//without a trace file
+//
+
+#include "SystemConfiguration.h"
+#include "Transaction.h"
+#include "IniReader.h"
+#include <random>
+#include <map>
+
+//every generated request covers one cache line
+#define WORKLOAD_LINE_BYTES 64
+
+namespace DRAMSim
+{
+enum WorkloadPattern
+{
+	PATTERN_SEQUENTIAL,
+	PATTERN_STRIDED,
+	PATTERN_RANDOM,
+	PATTERN_ZIPF,
+	PATTERN_CHASE
+};
+
+//One request stream. Its requests are spread over a DRAM and an NVM tier,
+//  each with its own working set laid out at the start of the tier
+class WorkloadStream
+{
+public:
+	WorkloadStream(unsigned id, const IniReader::OverrideMap &params, uint64_t seed, uint64_t dramBytes, uint64_t nvmBytes);
+
+	//builds the next request of the stream and schedules the one after it
+	Transaction *generate();
+	//true once the stream may issue at currentCycle
+	bool isReady(uint64_t currentCycle);
+	bool isDone() { return numIssued == numRequests; }
+	//its oldest outstanding read has returned
+	void readComplete(uint64_t currentCycle);
+	void printStats();
+
+	uint64_t getNextCycle() { return (uint64_t)nextArrival; }
+
+private:
+	uint64_t nextLine(unsigned tier);
+	double nextUniform();
+	void initZipf(unsigned tier);
+	void initChase(unsigned tier);
+
+	unsigned id;
+	WorkloadPattern pattern;
+	std::mt19937_64 random;
+
+	//configuration
+	uint64_t numRequests;
+	double rate;
+	bool poissonArrivals;
+	double readFraction;
+	double nvmFraction;
+	uint64_t stride;
+	double zipfTheta;
+
+	//per tier (0 is DRAM, 1 is NVM) layout and pattern state
+	uint64_t tierBase[2];
+	uint64_t tierLines[2];
+	uint64_t cursor[2];
+	double zipfZetan[2];
+	double zipfEta[2];
+	std::vector<uint32_t> chaseNext[2];
+
+	//arrival schedule in cpu cycles; a pointer chase waits for its last read
+	double nextArrival;
+	bool waiting;
+
+	//stats
+	uint64_t numIssued;
+	uint64_t numReads;
+	uint64_t numNvm;
+};
+
+//Merges the streams by arrival time and hands their requests to the
+//  simulation loop. Deterministic for a given seed and set of streams
+class WorkloadGenerator
+{
+public:
+	WorkloadGenerator(uint64_t seed, uint64_t dramBytes, uint64_t nvmBytes);
+	virtual ~WorkloadGenerator();
+
+	void addStream(const IniReader::OverrideMap &params);
+	//returns the oldest request that is due by currentCycle, NULL if none is
+	Transaction *nextRequest(uint64_t currentCycle);
+	bool isDone();
+	//read completion callback of the memory system
+	void readComplete(unsigned id, uint64_t address, uint64_t cycle);
+	void printStats();
+
+private:
+	uint64_t seed;
+	uint64_t dramBytes;
+	uint64_t nvmBytes;
+	uint64_t currentCycle;
+	std::vector<WorkloadStream *> streams;
+	//the stream of each read in flight, by address in issue order; a
+	//	completion goes to the oldest read of its address
+	std::multimap<uint64_t, unsigned> outstandingReads;
+};
+}
+
+#endif
+
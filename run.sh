@@ -1,5 +1,5 @@
 #This is an example of running the HMSim1.
-# -c: number of memory requests.
+# -c: number of memory requests (optional, the whole trace is replayed by default).
 # -S: DRAM capacity
 # -X: NVM capacity
 
@@ -0,0 +1,141 @@
+/*********************************************************************************
+*  Copyright (c) 2010-2011, Elliott Cooper-Balis
+*                             Paul Rosenfeld
+*                             Bruce Jacob
+*                             University of Maryland 
+*                             dramninjas [at] gmail [dot] com
+*  All rights reserved.
+*  
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions are met:
+*  
+*     * Redistributions of source code must retain the above copyright notice,
+*        this list of conditions and the following disclaimer.
+*  
+*     * Redistributions in binary form must reproduce the above copyright notice,
+*        this list of conditions and the following disclaimer in the documentation
+*        and/or other materials provided with the distribution.
+*  
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+*  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+*  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+*  DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+*  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+*  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+*  SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+*  OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+
+
+
+//CommandQueueTest.cpp
+//
+//Checks which queued read CommandQueue::nextRead reports as waiting for a
+//	bank, which decides whether a running PCM array write is paused or
+//	cancelled for it. Run from the top directory with 'make test'.
+//
+
+#include <sstream>
+#include "../CommandQueue.h"
+
+using namespace std;
+using namespace DRAMSim;
+
+//defined by the trace driver, which the test isn't linked with
+int SHOW_SIM_OUTPUT = 0;
+ofstream visDataOut;
+size_t cpuCycle = 0;
+unsigned long timerActual = 0;
+
+static unsigned failures = 0;
+
+static IniReader *loadPcm(const string &policy)
+{
+	IniReader *iniReader = new IniReader(TYPE_NVM, 2048);
+	iniReader->ReadIniFile("conf/PCM_micron_16M_8B_x16_sg25E.ini", false);
+	iniReader->ReadIniFile("conf/systempcm.ini", true);
+	iniReader->ReadIniFile("conf/debug_config.ini", true);
+	iniReader->SetKey("SCHEDULING_POLICY", policy, true);
+	iniReader->InitEnumsFromStrings();
+	if (!iniReader->CheckIfAllSet())
+	{
+		exit(-1);
+	}
+	return iniReader;
+}
+
+//queues an access to bank 0 of rank 0 the way the controller does, as an
+//	activate with its column access right behind it
+static BusPacket *enqueueAccess(CommandQueue &queue, ObjectPool<BusPacket> &pool, BusPacketType type, unsigned row, uint32_t id)
+{
+	BusPacket *access = new (pool.allocate()) BusPacket(type, 0, 0, row, 0, 0, NULL, id);
+	queue.enqueue(new (pool.allocate()) BusPacket(ACTIVATE, 0, 0, row, 0, 0, NULL, id));
+	queue.enqueue(access);
+	return access;
+}
+
+static void check(bool passed, const string &policy, const char *what)
+{
+	cout << (passed ? "PASS " : "FAIL ") << policy << ": " << what << endl;
+	if (!passed)
+	{
+		failures++;
+	}
+}
+
+static void testPolicy(const string &policy)
+{
+	IniReader *iniReader = loadPcm(policy);
+	ostringstream log;
+	BankStateTable bankStates(iniReader->NUM_RANKS, iniReader->NUM_BANKS);
+	TimingWheel timingWheel;
+	ObjectPool<BusPacket> busPacketPool("bus packets");
+	bool scheduled = policy != "rank_then_bank_round_robin";
+	{
+		CommandQueue queue(bankStates, log, iniReader, timingWheel, busPacketPool);
+		check(queue.nextRead(0, 0) == NULL, policy, "no read in an empty bank");
+
+		//a write to another row sits ahead of the read; a scheduler may
+		//	take the read first, round robin serves the bank in order
+		enqueueAccess(queue, busPacketPool, WRITE_P, 1, 1);
+		BusPacket *read = enqueueAccess(queue, busPacketPool, READ_P, 2, 2);
+		check(queue.nextRead(0, 0) == (scheduled ? read : NULL), policy, "read behind a write to another row");
+
+		//a read queued later to yet another row doesn't take its place
+		enqueueAccess(queue, busPacketPool, READ_P, 3, 3);
+		check(queue.nextRead(0, 0) == (scheduled ? read : NULL), policy, "oldest of two reads");
+	}
+	{
+		//a read behind a write to its own row can't go before that write
+		CommandQueue queue(bankStates, log, iniReader, timingWheel, busPacketPool);
+		enqueueAccess(queue, busPacketPool, WRITE_P, 1, 1);
+		enqueueAccess(queue, busPacketPool, READ_P, 1, 2);
+		check(queue.nextRead(0, 0) == NULL, policy, "read behind a write to its row");
+	}
+	{
+		CommandQueue queue(bankStates, log, iniReader, timingWheel, busPacketPool);
+		BusPacket *read = enqueueAccess(queue, busPacketPool, READ_P, 1, 1);
+		enqueueAccess(queue, busPacketPool, WRITE_P, 2, 2);
+		check(queue.nextRead(0, 0) == read, policy, "read ahead of a write");
+	}
+	delete iniReader;
+}
+
+int main()
+{
+	testPolicy("rank_then_bank_round_robin");
+	testPolicy("fr_fcfs");
+	testPolicy("atlas");
+	testPolicy("bliss");
+	testPolicy("par_bs");
+	if (failures > 0)
+	{
+		cout << failures << " checks failed" << endl;
+		return 1;
+	}
+	cout << "All checks passed" << endl;
+	return 0;
+}